@@ -0,0 +1,104 @@
+/**
+ * lrt_bench, benchmarks of the DSP code without Rack
+ *
+ * Links against lrt_dsp, see CMakeLists.txt:
+ *   cmake -S . -B build -DCMAKE_BUILD_TYPE=Release && cmake --build build --target lrt_bench
+ *   build/lrt_bench [suite]
+ *
+ * Golden signals committed in bench/golden and regression check against a local baseline of timings,
+ * see Regression.cpp:
+ *   build/lrt_bench golden [record]
+ *   build/lrt_bench record baseline
+ *   build/lrt_bench verify baseline [percent]
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include "Bench.hpp"
+
+
+/**
+ * @brief Benchmark suite with name and description for the usage
+ */
+struct Suite {
+    const char *name;
+    int (*run)();
+    const char *description;
+};
+
+
+static const Suite suites[] = {
+        {"perf",       perfBench,       "ns/sample and samples/sec of the DSP blocks at 44.1/48/96/192 kHz"},
+        {"pitch",      pitchBench,      "accuracy and speed of the pitch conversion against powf()"},
+        {"oscillator", oscillatorBench, "aliasing and CPU of the BLIT and the polyBLEP core"},
+        {"filter",     filterBench,     "aliasing and CPU of the classic and the ZDF ladder core"},
+        {"waveshaper", waveshaperBench, "accuracy, aliasing and CPU of the ADAA waveshapers"},
+};
+
+
+/**
+ * @brief Print usage
+ * @param name Name of the executable
+ */
+static void usage(const char *name) {
+    printf("usage: %s [suite|all]\n\n", name);
+
+    for (const Suite &s : suites) {
+        printf("  %-12s %s\n", s.name, s.description);
+    }
+
+    printf("\nwithout argument the perf suite is run\n\n");
+    printf("usage: %s golden [record]\n", name);
+    printf("       %s record <dir>\n", name);
+    printf("       %s verify <dir> [percent]\n\n", name);
+    printf("  golden       fail on signals out of tolerance against %s,\n", LRT_GOLDEN_DIR);
+    printf("               with record rewrite them after an intended change of the sound\n");
+    printf("  record       store ns/sample of all perf cases in dir\n");
+    printf("  verify       fail on golden signals out of tolerance or perf cases slower by more\n");
+    printf("               than percent, default %d, timings only compare on the same machine\n", BENCH_SLOWDOWN);
+}
+
+
+int main(int argc, char **argv) {
+    rack::engineSetSampleRate(BENCH_SR);
+
+    if (argc == 2 && strcmp(argv[1], "golden") == 0) {
+        return verifyGolden(LRT_GOLDEN_DIR);
+    }
+
+    if (argc == 3 && strcmp(argv[1], "golden") == 0 && strcmp(argv[2], "record") == 0) {
+        return recordGolden(LRT_GOLDEN_DIR);
+    }
+
+    if (argc == 3 && strcmp(argv[1], "record") == 0) {
+        return recordRegression(argv[2]);
+    }
+
+    if ((argc == 3 || argc == 4) && strcmp(argv[1], "verify") == 0) {
+        double slowdown = argc == 4 ? atof(argv[3]) : BENCH_SLOWDOWN;
+        return verifyRegression(argv[2], slowdown);
+    }
+
+    const char *name = argc > 1 ? argv[1] : "perf";
+    bool all = strcmp(name, "all") == 0;
+    int result = 0, found = 0;
+
+    for (const Suite &s : suites) {
+        if (!all && strcmp(name, s.name) != 0) continue;
+
+        if (all) printf("\n***** %s\n\n", s.name);
+
+        /* suites measuring at a fixed rate expect BENCH_SR */
+        rack::engineSetSampleRate(BENCH_SR);
+
+        result |= s.run();
+        found++;
+    }
+
+    if (!found) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    return result;
+}
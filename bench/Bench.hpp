@@ -0,0 +1,115 @@
+#pragma once
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+#include "DSPHost.hpp"
+
+#define BENCH_SR 44100 // sample rate of the suites measuring at a fixed rate
+#define BENCH_REPEAT 5 // repetitions of every measurement, the best one counts
+#define BENCH_SLOWDOWN 20 // default slowdown in percent accepted by verify, timings of short kernels jitter by about 10%
+
+/* committed golden signals, CMake passes the absolute path */
+#ifndef LRT_GOLDEN_DIR
+#define LRT_GOLDEN_DIR "bench/golden"
+#endif
+
+/* benchmark suites of lrt_bench, return 0 on success */
+int perfBench();
+int pitchBench();
+int oscillatorBench();
+int filterBench();
+int waveshaperBench();
+
+
+/**
+ * @brief One case of the perf suite, returns ns per sample at the given sample rate
+ */
+struct PerfCase {
+    const char *name;
+    std::function<double(int sr)> run;
+};
+
+const std::vector<PerfCase> &perfCases();
+
+/* golden output and performance regression check, return 0 on success */
+int recordGolden(const std::string &dir);
+int verifyGolden(const std::string &dir);
+int recordRegression(const std::string &dir);
+int verifyRegression(const std::string &dir, double slowdown);
+
+
+/**
+ * @brief Best time per sample of a function over BENCH_REPEAT runs
+ * @param samples Samples processed by one call of fn
+ * @param fn Processes samples samples and returns a value depending on all of them
+ * @return ns per sample
+ */
+template<typename FN>
+inline double bestTime(int samples, FN fn) {
+    double best = 1e9;
+
+    for (int r = 0; r < BENCH_REPEAT; r++) {
+        auto t0 = std::chrono::steady_clock::now();
+        float sum = fn();
+        auto t1 = std::chrono::steady_clock::now();
+
+        /* keep the result alive */
+        asm volatile("" : : "x"(sum));
+
+        double t = std::chrono::duration<double, std::nano>(t1 - t0).count() / samples;
+        if (t < best) best = t;
+    }
+
+    return best;
+}
+
+
+/**
+ * @brief Power of one frequency with the Goertzel algorithm
+ * @param x Signal of exactly one second, so every whole frequency is a bin
+ * @param f Frequency in whole Hz
+ * @param sr Sample rate
+ * @return
+ */
+template<typename T>
+inline double goertzel(const std::vector<T> &x, double f, int sr) {
+    double w = 2 * M_PI * f / sr, c = 2 * cos(w);
+    double s1 = 0, s2 = 0;
+
+    for (T v : x) {
+        double s = v + c * s1 - s2;
+        s2 = s1;
+        s1 = s;
+    }
+
+    double re = s1 - s2 * cos(w), im = s2 * sin(w);
+
+    return (re * re + im * im) * 2 / ((double) x.size() * x.size());
+}
+
+
+/**
+ * @brief Power of everything that is not a harmonic of f, relative to the harmonics
+ * @param x Signal of exactly one second
+ * @param f Fundamental in whole Hz
+ * @param sr Sample rate
+ * @return Alias level in dB
+ */
+template<typename T>
+inline double aliasLevel(const std::vector<T> &x, int f, int sr) {
+    double mean = 0, total = 0, harmonics = 0;
+
+    for (T v : x) mean += v;
+    mean /= x.size();
+
+    for (T v : x) total += (v - mean) * (v - mean);
+    total /= x.size();
+
+    for (int k = f; k < sr / 2; k += f) harmonics += goertzel(x, k, sr);
+
+    return 10 * log10(fmax(total - harmonics, 1e-30) / harmonics);
+}
@@ -0,0 +1,163 @@
+/**
+ * Aliasing, CPU and output levels of the classic and the zero-delay-feedback ladder core, suite "filter" of lrt_bench
+ *
+ * A loud sine drives the nonlinearities of both cores, everything that is not a harmonic of it is aliasing.
+ * The BP output is measured, it is not affected by the overdrive of the LP output at the base rate. The levels
+ * of all outputs are compared with a saw, switching cores in SimpleFilter should not change them much.
+ */
+
+#include <algorithm>
+#include "Bench.hpp"
+#include "LadderFilter.hpp"
+#include "ZDFLadderFilter.hpp"
+
+#define FILTER_BLOCKSIZE 16 // block size of SimpleFilter
+#define FILTER_TONE 2489    // test tone in whole Hz, not a divisor of the sample rate
+#define FILTER_LEVEL 0.5f   // test tone amplitude at the filter input, 0.6 is the clamp level of SimpleFilter
+#define FILTER_CUTOFF 0.7f
+#define FILTER_SAW 110      // saw of the level comparison in Hz
+#define FILTER_SAW_LEVEL 0.1f // 5 V at the filter input of SimpleFilter
+
+
+/**
+ * @brief Filter one second of input in blocks into all outputs
+ * @param filter LadderFilter or ZDFLadderFilter
+ * @param in One second of input
+ * @param lp
+ * @param hp
+ * @param bp
+ * @param ns Best time per sample of all outputs
+ */
+template<typename FILTER>
+static void render(FILTER &filter, const std::vector<float> &in, std::vector<float> &lp, std::vector<float> &hp,
+                   std::vector<float> &bp, double &ns) {
+    ns = 1e9;
+
+    /* the last of five rendered seconds is kept */
+    for (int r = 0; r < 5; r++) {
+        auto t0 = std::chrono::steady_clock::now();
+
+        for (int i = 0; i < BENCH_SR; i += FILTER_BLOCKSIZE) {
+            int n = std::min(FILTER_BLOCKSIZE, BENCH_SR - i);
+            filter.process(&in[i], &lp[i], &hp[i], &bp[i], n);
+        }
+
+        auto t1 = std::chrono::steady_clock::now();
+        double t = std::chrono::duration<double, std::nano>(t1 - t0).count() / BENCH_SR;
+
+        if (t < ns) ns = t;
+    }
+}
+
+
+/**
+ * @brief Alias level and time per sample of one core at one setting
+ * @param filter LadderFilter or ZDFLadderFilter
+ * @param in One second of input
+ * @param factor Oversampling factor
+ * @param res Resonance
+ * @param drive Drive knob, squared as in SimpleFilter
+ * @param ns Best time per sample
+ * @return Alias level in dB
+ */
+template<typename FILTER>
+static double measure(FILTER &filter, const std::vector<float> &in, int factor, float res, float drive, double &ns) {
+    filter.setOversampling(factor);
+    filter.setFrequency(FILTER_CUTOFF);
+    filter.setResonance(res);
+    filter.setDrive(drive * drive);
+
+    std::vector<float> lp(BENCH_SR), hp(BENCH_SR), bp(BENCH_SR);
+    render(filter, in, lp, hp, bp, ns);
+
+    return aliasLevel(bp, FILTER_TONE, BENCH_SR);
+}
+
+
+/**
+ * @brief RMS level of a signal in dB
+ * @param x
+ * @return
+ */
+static double level(const std::vector<float> &x) {
+    double sum = 0;
+
+    for (float v : x) sum += (double) v * v;
+
+    return 10 * log10(fmax(sum / x.size(), 1e-30));
+}
+
+
+/**
+ * @brief Print the levels of all outputs of one core for the saw
+ * @param filter LadderFilter or ZDFLadderFilter
+ * @param in One second of the saw
+ * @param cutoff
+ * @param res
+ */
+template<typename FILTER>
+static void printLevels(FILTER &filter, const std::vector<float> &in, float cutoff, float res) {
+    std::vector<float> lp(BENCH_SR), hp(BENCH_SR), bp(BENCH_SR);
+    double ns;
+
+    filter.setFrequency(cutoff);
+    filter.setResonance(res);
+
+    render(filter, in, lp, hp, bp, ns);
+
+    printf("%7.1f dB %7.1f dB %7.1f dB", level(lp), level(hp), level(bp));
+}
+
+
+int filterBench() {
+    /* resonance and drive, 1.3 is close to self-oscillation */
+    static const float settings[][2] = {{0.3f, 0.f}, {0.9f, 0.8f}, {1.3f, 0.f}};
+    static const int factors[] = {2, 4, 8};
+
+    std::vector<float> in(BENCH_SR);
+
+    for (int i = 0; i < BENCH_SR; i++) {
+        in[i] = FILTER_LEVEL * (float) sin(2 * M_PI * FILTER_TONE * i / BENCH_SR);
+    }
+
+    printf("%-12s %4s %6s   %-22s\n", "", "res", "drive", "BP alias / ns");
+
+    for (const float *s : settings) {
+        for (int factor : factors) {
+            LadderFilter classic;
+            ZDFLadderFilter zdf;
+            double nsClassic, nsZdf;
+
+            double aClassic = measure(classic, in, factor, s[0], s[1], nsClassic);
+            double aZdf = measure(zdf, in, factor, s[0], s[1], nsZdf);
+
+            printf("classic %2dx  %4.1f %6.1f   %7.1f dB %6.1f ns\n", factor, s[0], s[1], aClassic, nsClassic);
+            printf("zdf     %2dx  %4.1f %6.1f   %7.1f dB %6.1f ns\n", factor, s[0], s[1], aZdf, nsZdf);
+        }
+
+        printf("\n");
+    }
+
+    std::vector<float> saw(BENCH_SR);
+
+    for (int i = 0; i < BENCH_SR; i++) {
+        saw[i] = FILTER_SAW_LEVEL * (float) (2 * fmod((double) FILTER_SAW * i / BENCH_SR, 1.) - 1);
+    }
+
+    printf("output level, %3d Hz saw     %-35s%s\n", FILTER_SAW, "classic LP / HP / BP", "zdf LP / HP / BP");
+
+    for (float res : {0.f, 0.5f, 1.f}) {
+        for (float cutoff : {0.2f, 0.4f, 0.6f, 0.8f}) {
+            LadderFilter classic;
+            ZDFLadderFilter zdf;
+
+            printf("cutoff %.1f  res %.1f        ", cutoff, res);
+            printLevels(classic, saw, cutoff, res);
+            printf("   ");
+            printLevels(zdf, saw, cutoff, res);
+            printf("\n");
+        }
+    }
+
+    return 0;
+}
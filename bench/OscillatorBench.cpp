@@ -0,0 +1,115 @@
+/**
+ * Aliasing and CPU comparison of the BLIT and the polyBLEP oscillator core, suite "oscillator" of lrt_bench
+ */
+
+#include "Bench.hpp"
+#include "Oscillator.hpp"
+#include "BLEPOscillator.hpp"
+
+
+/**
+ * @brief Render one waveform of a core at a fixed frequency
+ * @param osc Oscillator core
+ * @param f Frequency in whole Hz
+ * @param wave OSC_WAVE_* flag
+ * @param ns Best time per sample
+ * @return The last of five rendered seconds
+ */
+template<typename OSC>
+static std::vector<float> render(OSC &osc, int f, int wave, double &ns) {
+    std::vector<float> out(BENCH_SR);
+
+    osc.setFrequency(f);
+    osc.setWaveMask(wave);
+
+    ns = 1e9;
+
+    for (int r = 0; r < 5; r++) {
+        auto t0 = std::chrono::steady_clock::now();
+
+        for (int i = 0; i < BENCH_SR; i++) {
+            osc.proccess();
+
+            out[i] = wave == OSC_WAVE_RAMP ? osc.getRampWave() :
+                     wave == OSC_WAVE_SAW ? osc.getSawWave() :
+                     wave == OSC_WAVE_PULSE ? osc.getPulseWave() : osc.getTriangleWave();
+        }
+
+        auto t1 = std::chrono::steady_clock::now();
+        double t = std::chrono::duration<double, std::nano>(t1 - t0).count() / BENCH_SR;
+
+        if (t < ns) ns = t;
+    }
+
+    return out;
+}
+
+
+/**
+ * @brief Time per sample with all waveforms computed
+ * @param osc Oscillator core
+ * @return
+ */
+template<typename OSC>
+static double allWaves(OSC &osc) {
+    double best = 1e9;
+    float sum = 0.f;
+
+    osc.setFrequency(440.f);
+    osc.setWaveMask(OSC_WAVE_ALL);
+
+    for (int r = 0; r < 5; r++) {
+        auto t0 = std::chrono::steady_clock::now();
+
+        for (int i = 0; i < BENCH_SR; i++) {
+            osc.proccess();
+            sum += osc.getSawWave() + osc.getPulseWave() + osc.getSawTriWave() + osc.getTriangleWave();
+        }
+
+        auto t1 = std::chrono::steady_clock::now();
+        double t = std::chrono::duration<double, std::nano>(t1 - t0).count() / BENCH_SR;
+
+        if (t < best) best = t;
+    }
+
+    /* keep the sum alive */
+    asm volatile("" : : "r"(sum));
+
+    return best;
+}
+
+
+int oscillatorBench() {
+    static const int freqs[] = {220, 1760, 4186};
+    /* the BLIT ramp is the saw before the output shaping */
+    static const int waves[] = {OSC_WAVE_RAMP, OSC_WAVE_SAW, OSC_WAVE_PULSE, OSC_WAVE_TRI};
+    static const char *names[] = {"ramp", "saw", "pulse", "tri"};
+
+    printf("%-6s %6s   %-22s %-22s\n", "", "Hz", "BLIT alias / ns", "BLEP alias / ns");
+
+    for (int w = 0; w < 4; w++) {
+        for (int f : freqs) {
+            BLITOscillator blit;
+            BLEPOscillator blep;
+            double nsBlit, nsBlep;
+
+            blit.setFixedPhase(true);
+
+            /* settle integrators and DC blockers, then measure */
+            render(blit, f, waves[w], nsBlit);
+            double aBlit = aliasLevel(render(blit, f, waves[w], nsBlit), f, BENCH_SR);
+            double aBlep = aliasLevel(render(blep, f, waves[w], nsBlep), f, BENCH_SR);
+
+            printf("%-6s %6d   %7.1f dB %6.1f ns   %7.1f dB %6.1f ns\n", names[w], f, aBlit, nsBlit, aBlep, nsBlep);
+        }
+    }
+
+    BLITOscillator blit;
+    BLEPOscillator blep;
+
+    blit.setFixedPhase(true);
+
+    printf("\nall waveforms  BLIT %6.1f ns  BLEP %6.1f ns\n", allWaves(blit), allWaves(blep));
+
+    return 0;
+}
@@ -0,0 +1,298 @@
+/**
+ * CPU of the DSP blocks and of every DSPMath function at common sample rates, suite "perf" of lrt_bench
+ *
+ * Every case is built fresh at each sample rate and processes one second of audio per run. Functions of
+ * DSPMath are timed over one second of input values, SSE variants count four values per call.
+ */
+
+#include "Bench.hpp"
+#include "LadderFilter.hpp"
+#include "ZDFLadderFilter.hpp"
+#include "Oscillator.hpp"
+#include "BLEPOscillator.hpp"
+#include "Waveshaper.hpp"
+#include "ReShaperCurveBank.hpp"
+
+#define PERF_BLOCKSIZE 16 // block size of the block processing APIs
+
+
+/**
+ * @brief Slow sweep through lo..hi, one second at the given sample rate
+ * @param lo
+ * @param hi
+ * @param sr
+ * @return
+ */
+static std::vector<float> sweep(float lo, float hi, int sr) {
+    std::vector<float> x(sr);
+
+    for (int i = 0; i < sr; i++) {
+        x[i] = lo + (hi - lo) * (0.5f + 0.5f * sinf(2.f * (float) M_PI * 3.f * i / sr));
+    }
+
+    return x;
+}
+
+
+/**
+ * @brief Time of a scalar function over a sweep
+ * @param lo Lowest input
+ * @param hi Highest input
+ * @param sr Sample rate, the sweep is one second long
+ * @param fn
+ * @return
+ */
+template<typename FN>
+static double scalarCase(float lo, float hi, int sr, FN fn) {
+    std::vector<float> in = sweep(lo, hi, sr), out(sr);
+
+    /* results go to memory, a running sum would measure the latency of the additions */
+    return bestTime(sr, [&]() {
+        for (int i = 0; i < sr; i++) out[i] = (float) fn(in[i]);
+
+        asm volatile("" : : "r"(out.data()) : "memory");
+        return out[sr - 1];
+    });
+}
+
+
+/**
+ * @brief Time of a SSE function over a sweep, four values per call
+ * @param lo Lowest input
+ * @param hi Highest input
+ * @param sr Sample rate, the sweep is one second long
+ * @param fn
+ * @return
+ */
+template<typename FN>
+static double sseCase(float lo, float hi, int sr, FN fn) {
+    std::vector<float> in = sweep(lo, hi, sr), out(sr);
+    int n = sr & ~3;
+
+    return bestTime(n, [&]() {
+        for (int i = 0; i < n; i += 4) _mm_storeu_ps(&out[i], fn(_mm_loadu_ps(&in[i])));
+
+        asm volatile("" : : "r"(out.data()) : "memory");
+        return out[n - 1];
+    });
+}
+
+
+/**
+ * @brief Time of a filter core in blocks of PERF_BLOCKSIZE samples
+ * @param filter
+ * @param sr
+ * @return
+ */
+template<typename FILTER>
+static double filterCase(FILTER &filter, int sr) {
+    std::vector<float> in = sweep(-0.5f, 0.5f, sr);
+    float lp[PERF_BLOCKSIZE], hp[PERF_BLOCKSIZE], bp[PERF_BLOCKSIZE];
+    int n = sr - sr % PERF_BLOCKSIZE;
+
+    filter.setFrequency(0.5f);
+    filter.setResonance(0.8f);
+    filter.setDrive(0.1f);
+
+    return bestTime(n, [&]() {
+        float sum = 0.f;
+
+        for (int i = 0; i < n; i += PERF_BLOCKSIZE) {
+            filter.process(&in[i], lp, hp, bp, PERF_BLOCKSIZE);
+            sum += lp[0] + hp[0] + bp[0];
+        }
+
+        return sum;
+    });
+}
+
+
+/**
+ * @brief Time of an oscillator core at 440 Hz with all waveforms computed
+ * @param osc
+ * @param sr
+ * @return
+ */
+template<typename OSC>
+static double oscillatorCase(OSC &osc, int sr) {
+    osc.setFrequency(440.f);
+    osc.setWaveMask(OSC_WAVE_ALL);
+
+    return bestTime(sr, [&]() {
+        float sum = 0.f;
+
+        for (int i = 0; i < sr; i++) {
+            osc.proccess();
+            sum += osc.getSawWave() + osc.getPulseWave() + osc.getSawTriWave() + osc.getTriangleWave();
+        }
+
+        return sum;
+    });
+}
+
+
+static const std::vector<PerfCase> cases = {
+        /* processing blocks */
+        {"LadderFilter 8x", [](int sr) {
+            LadderFilter f;
+            f.setOversampling(8);
+            return filterCase(f, sr);
+        }},
+        {"LadderFilter 2x", [](int sr) {
+            LadderFilter f;
+            f.setOversampling(2);
+            return filterCase(f, sr);
+        }},
+        {"ZDFLadderFilter 2x", [](int sr) {
+            ZDFLadderFilter f;
+            f.setOversampling(2);
+            return filterCase(f, sr);
+        }},
+        {"BLITOscillator", [](int sr) {
+            BLITOscillator osc;
+            return oscillatorCase(osc, sr);
+        }},
+        {"BLEPOscillator", [](int sr) {
+            BLEPOscillator osc;
+            return oscillatorCase(osc, sr);
+        }},
+        {"ReShaper curve", [](int sr) {
+            ReShaperCurve c;
+            c.setAmount(10.f);
+            return scalarCase(-1.f, 1.f, sr, [&c](float x) { return c.value(x); });
+        }},
+        {"ReShaper ADAA", [](int sr) {
+            ADAA<ReShaperCurve> a;
+            a.curve.setAmount(10.f);
+            a.update();
+            return scalarCase(-1.f, 1.f, sr, [&a](float x) { return a.process(x); });
+        }},
+        {"ReShaper SSE", [](int sr) {
+            ReShaperCurveSSE c;
+            c.setAmount(_mm_set1_ps(10.f));
+            return sseCase(-1.f, 1.f, sr, [&c](__m128 x) { return c.value(x); });
+        }},
+        {"ReShaper ADAA SSE", [](int sr) {
+            ADAASSE<ReShaperCurveSSE> a;
+            a.curve.setAmount(_mm_set1_ps(10.f));
+            a.update();
+            return sseCase(-1.f, 1.f, sr, [&a](__m128 x) { return a.process(x); });
+        }},
+
+        /* DSPMath */
+        {"wrapTWOPI", [](int sr) { return scalarCase(-20.f, 20.f, sr, wrapTWOPI); }},
+        {"getPhaseIncrement", [](int sr) {
+            float isr = 1.f / sr;
+            return scalarCase(20.f, 20000.f, sr, [isr](float f) { return getPhaseIncrement(f, isr); });
+        }},
+        {"getPhaseIncrementFixed", [](int sr) {
+            float isr = 1.f / sr;
+            return scalarCase(20.f, 20000.f, sr, [isr](float f) { return getPhaseIncrementFixed(f, isr); });
+        }},
+        {"clipl", [](int sr) { return scalarCase(-2.f, 2.f, sr, [](float x) { return clipl(x, 1.f); }); }},
+        {"cliph", [](int sr) { return scalarCase(-2.f, 2.f, sr, [](float x) { return cliph(x, 1.f); }); }},
+        {"fastSinWrap", [](int sr) { return scalarCase(-20.f, 20.f, sr, fastSinWrap); }},
+        {"fastSin", [](int sr) { return scalarCase(-3.14f, 3.14f, sr, fastSin); }},
+        {"qsinhp", [](int sr) { return scalarCase(-3.14f, 3.14f, sr, qsinhp); }},
+        {"qsinlp", [](int sr) { return scalarCase(-3.14f, 3.14f, sr, qsinlp); }},
+        {"BLIT", [](int sr) { return scalarCase(0.f, 6.28f, sr, [](float x) { return BLIT(50.f, x); }); }},
+        {"BLITcore", [](int sr) { return scalarCase(0.f, 6.28f, sr, [](float x) { return BLITcore(50.f, x); }); }},
+        {"BLITKernel", [](int sr) {
+            BLITKernel k;
+            k.setHarmonics(50);
+            return scalarCase(0.f, 6.28f, sr, [&k](float x) { return k.compute(x); });
+        }},
+        {"shape1", [](int sr) { return scalarCase(-4.f, 4.f, sr, [](float x) { return shape1(0.778f, x); }); }},
+        {"saturate", [](int sr) { return scalarCase(-2.f, 2.f, sr, [](float x) { return saturate(x, 0.5); }); }},
+        {"overdrive", [](int sr) { return scalarCase(-3.f, 3.f, sr, overdrive); }},
+        {"clip", [](int sr) { return scalarCase(-2.f, 2.f, sr, [](float x) { return clip(x, 1., 1.); }); }},
+        {"saturate2", [](int sr) { return scalarCase(-2.f, 2.f, sr, saturate2); }},
+        {"fastTanh", [](int sr) { return scalarCase(-4.f, 4.f, sr, fastTanh); }},
+        {"sineTable.lookup", [](int sr) {
+            return scalarCase(-2.f, 2.f, sr, [](float x) { return sineTable.lookup(x); });
+        }},
+        {"polyBLEP", [](int sr) {
+            float dt = 440.f / sr;
+            return scalarCase(0.f, 1.f, sr, [dt](float t) { return polyBLEP(t, dt, 1.f / dt); });
+        }},
+        {"polyBLAMP", [](int sr) {
+            float dt = 440.f / sr;
+            return scalarCase(0.f, 1.f, sr, [dt](float t) { return polyBLAMP(t, dt, 1.f / dt); });
+        }},
+        {"fastExp2", [](int sr) { return scalarCase(-13.f, 13.f, sr, fastExp2); }},
+        {"fastLog", [](int sr) { return scalarCase(0.01f, 100.f, sr, fastLog); }},
+        {"fastAtan", [](int sr) { return scalarCase(-10.f, 10.f, sr, fastAtan); }},
+        {"fastExp2SSE", [](int sr) { return sseCase(-13.f, 13.f, sr, [](__m128 x) { return fastExp2SSE(x); }); }},
+        {"fastLogSSE", [](int sr) { return sseCase(0.01f, 100.f, sr, fastLogSSE); }},
+        {"fastAtanSSE", [](int sr) { return sseCase(-10.f, 10.f, sr, fastAtanSSE); }},
+        {"fastSinSSE", [](int sr) { return sseCase(-2.f, 2.f, sr, [](__m128 x) { return fastSinSSE(x); }); }},
+        {"fastRcpSSE", [](int sr) { return sseCase(1.f, 100.f, sr, fastRcpSSE); }},
+        {"Randomizer", [](int sr) {
+            Randomizer r(1);
+            return scalarCase(0.f, 1.f, sr, [&r](float) { return r.nextFloat(-1.f, 1.f); });
+        }},
+        {"Randomizer::fill", [](int sr) {
+            Randomizer r(1);
+            std::vector<float> buffer(PERF_BLOCKSIZE);
+            int n = sr - sr % PERF_BLOCKSIZE;
+
+            return bestTime(n, [&]() {
+                float sum = 0.f;
+
+                for (int i = 0; i < n; i += PERF_BLOCKSIZE) {
+                    r.fill(buffer.data(), PERF_BLOCKSIZE, -1.f, 1.f);
+                    sum += buffer[0];
+                }
+
+                return sum;
+            });
+        }},
+        {"Integrator", [](int sr) {
+            Integrator in;
+            return scalarCase(-1.f, 1.f, sr, [&in](float x) { return in.add(x, 0.01f); });
+        }},
+        {"DCBlocker", [](int sr) {
+            DCBlocker dc;
+            return scalarCase(-1.f, 1.f, sr, [&dc](float x) { return dc.filter(x); });
+        }},
+        {"LP6DBFilter", [](int sr) {
+            LP6DBFilter lp(1000.f, 1);
+            return scalarCase(-1.f, 1.f, sr, [&lp](float x) { return lp.filter(x); });
+        }},
+};
+
+
+/**
+ * @brief All cases of the perf suite, also timed by the regression check
+ * @return
+ */
+const std::vector<PerfCase> &perfCases() {
+    return cases;
+}
+
+
+int perfBench() {
+    static const int rates[] = {44100, 48000, 96000, 192000};
+
+    printf("%-24s", "");
+    for (int sr : rates) printf("  %7d Hz       ", sr);
+    printf("\n%-24s", "");
+    for (int i = 0; i < 4; i++) printf("  %7s %9s", "ns", "samples/s");
+    printf("\n");
+
+    for (const PerfCase &c : cases) {
+        printf("%-24s", c.name);
+
+        for (int sr : rates) {
+            rack::engineSetSampleRate(sr);
+
+            double ns = c.run(sr);
+            printf("  %7.2f %9.3g", ns, 1e9 / ns);
+        }
+
+        printf("\n");
+        fflush(stdout);
+    }
+
+    return 0;
+}
@@ -0,0 +1,109 @@
+/**
+ * Microbenchmark of the pitch conversion in src/dsp/Pitch.hpp against powf(), suite "pitch" of lrt_bench
+ */
+
+#include "Bench.hpp"
+#include "Pitch.hpp"
+
+#define BENCH_SIZE 4096
+#define BENCH_RUNS 2000
+
+
+/**
+ * @brief Run a conversion over the whole input buffer repeatedly, returns best time per value
+ * @param name
+ * @param in Input buffer
+ * @param out Output buffer
+ * @param fn Converts BENCH_SIZE values from in to out
+ * @return
+ */
+template<typename FN>
+static double bench(const char *name, const float *in, float *out, FN fn) {
+    double best = 1e9;
+
+    for (int r = 0; r < 10; r++) {
+        auto t0 = std::chrono::steady_clock::now();
+
+        for (int k = 0; k < BENCH_RUNS; k++) {
+            fn(in, out);
+
+            /* keep the compiler from merging the identical runs */
+            asm volatile("" : : "r"(out) : "memory");
+        }
+
+        auto t1 = std::chrono::steady_clock::now();
+        double ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / ((double) BENCH_RUNS * BENCH_SIZE);
+
+        if (ns < best) best = ns;
+    }
+
+    printf("%-16s %6.2f ns/value\n", name, best);
+    return best;
+}
+
+
+/**
+ * @brief Max. error in cents against exp2() in double precision
+ * @param in Input buffer
+ * @param out Output buffer
+ * @return
+ */
+static double maxCents(const float *in, const float *out) {
+    double max = 0;
+
+    for (int i = 0; i < BENCH_SIZE; i++) {
+        double cents = fabs(1200. * log2(out[i] / exp2((double) in[i])));
+        if (cents > max) max = cents;
+    }
+
+    return max;
+}
+
+
+int pitchBench() {
+    alignas(16) float in[BENCH_SIZE];
+    alignas(16) float out[BENCH_SIZE];
+
+    /* CV range of a 1V/Oct input plus octave switch */
+    for (int i = 0; i < BENCH_SIZE; i++) {
+        in[i] = -13.f + 26.f * i / BENCH_SIZE;
+    }
+
+    bench("powf(2, x)", in, out, [](const float *x, float *y) {
+        for (int i = 0; i < BENCH_SIZE; i++) y[i] = powf(2.f, x[i]);
+    });
+    printf("%-16s %9.6f cents\n", "", maxCents(in, out));
+
+    /* a constant base lets the compiler turn powf() into exp2f(), keep the real call as well */
+    static volatile float two = 2.f;
+    bench("powf(two, x)", in, out, [](const float *x, float *y) {
+        float base = two;
+        for (int i = 0; i < BENCH_SIZE; i++) y[i] = powf(base, x[i]);
+    });
+
+    bench("fastExp2", in, out, [](const float *x, float *y) {
+        for (int i = 0; i < BENCH_SIZE; i++) y[i] = fastExp2(x[i]);
+    });
+    printf("%-16s %9.6f cents\n", "", maxCents(in, out));
+
+    bench("fastExp2SSE", in, out, [](const float *x, float *y) {
+        for (int i = 0; i < BENCH_SIZE; i += 4) _mm_store_ps(y + i, fastExp2SSE(_mm_load_ps(x + i)));
+    });
+    printf("%-16s %9.6f cents\n", "", maxCents(in, out));
+
+    printf("\nguaranteed max. error: %.3f cents\n", PITCH_MAX_ERROR_CENTS);
+
+    /* latency matters for per-sample pitch updates, every result feeds the next input */
+    auto t0 = std::chrono::steady_clock::now();
+    float x = 0.1f;
+
+    for (int i = 0; i < BENCH_SIZE * BENCH_RUNS / 8; i++) {
+        x = fastExp2(x) * 1e-3f;
+    }
+
+    auto t1 = std::chrono::steady_clock::now();
+    printf("fastExp2 latency %6.2f ns (%g)\n",
+           std::chrono::duration<double, std::nano>(t1 - t0).count() / (BENCH_SIZE * BENCH_RUNS / 8), x);
+
+    return 0;
+}
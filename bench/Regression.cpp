@@ -0,0 +1,578 @@
+/**
+ * Golden output and performance regression check of the DSP core, commands "golden", "record" and "verify" of lrt_bench
+ *
+ * The golden signals are fixed-seed renders of the filters, oscillators, ReShaper curves and DSPMath helpers,
+ * committed in LRT_GOLDEN_DIR. "golden" renders again and compares against them within the tolerance of
+ * every case, ctest runs it. "golden record" rewrites them after an intended change of the sound.
+ *
+ * Timings only compare on the same machine, "record" stores the ns/sample of every perf case in a local
+ * directory, "verify" checks the golden signals and fails if any perf case got slower by more than a given
+ * percentage. Record a baseline before an optimisation and verify after it.
+ */
+
+#include <cerrno>
+#include <thread>
+#include <sys/stat.h>
+#include "Bench.hpp"
+#include "LadderFilter.hpp"
+#include "ZDFLadderFilter.hpp"
+#include "Oscillator.hpp"
+#include "BLEPOscillator.hpp"
+#include "Waveshaper.hpp"
+
+#define GOLDEN_LENGTH 4096    // samples of every golden signal, keeps the committed files small
+#define GOLDEN_BLOCKSIZE 16   // block size of the filter renders
+#define GOLDEN_SEED 1
+
+/* error of a render relative to its golden signal, in dB */
+#define GOLDEN_EXACT -100.f   // stateless functions, only differ by rounding
+#define GOLDEN_DIVIDING -90.f // stateless functions dividing by small values, rounding of other builds shows
+#define GOLDEN_FILTER -80.f   // nonlinear feedback, rounding differences grow
+#define GOLDEN_OSCILLATOR -60.f // integrators and phase accumulation
+
+#define REGRESSION_PERF_FILE "perf.txt"
+#define REGRESSION_ROUNDS 10 // a perf case runs for about a millisecond, its best round of these counts
+#define REGRESSION_RETRIES 3 // times a slower perf case is timed again, a real regression stays slow
+
+
+/**
+ * @brief One golden signal with its tolerance
+ */
+struct GoldenCase {
+    const char *name;
+    float tolerance; // highest error relative to the golden signal in dB
+    std::function<std::vector<float>()> render;
+};
+
+
+/**
+ * @brief Input of the filters and shapers: seeded noise over a sine sweep of 50 Hz to 5 kHz
+ * @param amplitude
+ * @return GOLDEN_LENGTH samples at BENCH_SR
+ */
+static std::vector<float> testSignal(float amplitude) {
+    std::vector<float> x(GOLDEN_LENGTH);
+    Randomizer rand(GOLDEN_SEED);
+    double phase = 0.;
+
+    for (int i = 0; i < GOLDEN_LENGTH; i++) {
+        double f = 50. * pow(100., (double) i / GOLDEN_LENGTH);
+        phase += 2. * M_PI * f / BENCH_SR;
+
+        x[i] = amplitude * (0.8f * (float) sin(phase) + rand.nextFloat(-0.2f, 0.2f));
+    }
+
+    return x;
+}
+
+
+/**
+ * @brief Evenly spaced values from lo to hi
+ * @param lo
+ * @param hi
+ * @return GOLDEN_LENGTH values
+ */
+static std::vector<float> grid(float lo, float hi) {
+    std::vector<float> x(GOLDEN_LENGTH);
+
+    for (int i = 0; i < GOLDEN_LENGTH; i++) {
+        x[i] = lo + (hi - lo) * i / (GOLDEN_LENGTH - 1);
+    }
+
+    return x;
+}
+
+
+/**
+ * @brief Map a scalar function over a grid
+ * @param lo
+ * @param hi
+ * @param fn
+ * @return
+ */
+template<typename FN>
+static std::vector<float> mapGrid(float lo, float hi, FN fn) {
+    std::vector<float> x = grid(lo, hi);
+
+    for (float &v : x) v = (float) fn(v);
+
+    return x;
+}
+
+
+/**
+ * @brief Render the test signal through a filter core with a cutoff sweep, LP, HP and BP interleaved
+ * @param filter
+ * @param factor Oversampling factor
+ * @param audioRate Sweep the cutoff at audio rate, otherwise setFrequency() once per block
+ * @return
+ */
+template<typename FILTER>
+static std::vector<float> renderFilter(FILTER &filter, int factor, bool audioRate = true) {
+    std::vector<float> in = testSignal(0.4f), cutoff = grid(0.2f, 0.9f), out;
+    float lp[GOLDEN_BLOCKSIZE], hp[GOLDEN_BLOCKSIZE], bp[GOLDEN_BLOCKSIZE];
+
+    filter.setOversampling(factor);
+    filter.setFrequency(0.5f);
+    filter.setResonance(0.8f);
+    filter.setDrive(0.1f);
+
+    for (int i = 0; i < GOLDEN_LENGTH; i += GOLDEN_BLOCKSIZE) {
+        if (!audioRate) filter.setFrequency(cutoff[i]);
+        filter.process(&in[i], audioRate ? &cutoff[i] : nullptr, lp, hp, bp, GOLDEN_BLOCKSIZE);
+
+        for (int k = 0; k < GOLDEN_BLOCKSIZE; k++) {
+            out.push_back(lp[k]);
+            out.push_back(hp[k]);
+            out.push_back(bp[k]);
+        }
+    }
+
+    return out;
+}
+
+
+/**
+ * @brief Render an oscillator core over a pitch sweep of five octaves, all waveforms interleaved
+ * @param osc
+ * @return
+ */
+template<typename OSC>
+static std::vector<float> renderOscillator(OSC &osc) {
+    std::vector<float> out;
+
+    osc.setSeed(GOLDEN_SEED);
+    osc.setWaveMask(OSC_WAVE_ALL);
+    osc.setPulseWidth(0.6f);
+
+    for (int i = 0; i < GOLDEN_LENGTH; i++) {
+        osc.updatePitch(-2.f + 5.f * i / GOLDEN_LENGTH, 0.f, 0.f, 0.f);
+        osc.proccess();
+
+        out.push_back(osc.getSawWave());
+        out.push_back(osc.getPulseWave());
+        out.push_back(osc.getSawTriWave());
+        out.push_back(osc.getTriangleWave());
+    }
+
+    return out;
+}
+
+
+static const std::vector<GoldenCase> goldenCases = {
+        /* processing blocks */
+        {"LadderFilter_8x", GOLDEN_FILTER, []() {
+            LadderFilter f;
+            f.setSeed(GOLDEN_SEED);
+            return renderFilter(f, 8);
+        }},
+        {"LadderFilter_2x", GOLDEN_FILTER, []() {
+            LadderFilter f;
+            f.setSeed(GOLDEN_SEED);
+            return renderFilter(f, 2);
+        }},
+        {"LadderFilter_2x_cr16", GOLDEN_FILTER, []() {
+            LadderFilter f;
+            f.setSeed(GOLDEN_SEED);
+            f.setControlRate(16);
+            return renderFilter(f, 2, false);
+        }},
+        {"LadderFilter_2x_cr32", GOLDEN_FILTER, []() {
+            LadderFilter f;
+            f.setSeed(GOLDEN_SEED);
+            f.setControlRate(32);
+            return renderFilter(f, 2, false);
+        }},
+        {"ZDFLadderFilter_2x", GOLDEN_FILTER, []() {
+            ZDFLadderFilter f;
+            return renderFilter(f, 2);
+        }},
+        {"BLITOscillator", GOLDEN_OSCILLATOR, []() {
+            BLITOscillator osc;
+            return renderOscillator(osc);
+        }},
+        {"BLITOscillator_fixed", GOLDEN_OSCILLATOR, []() {
+            BLITOscillator osc;
+            osc.setFixedPhase(true);
+            return renderOscillator(osc);
+        }},
+        {"BLEPOscillator", GOLDEN_OSCILLATOR, []() {
+            BLEPOscillator osc;
+            return renderOscillator(osc);
+        }},
+
+        /* ReShaper */
+        {"ReShaperCurve", GOLDEN_EXACT, []() {
+            std::vector<float> out;
+            ReShaperCurve c;
+
+            for (float a : {1.f, 5.f, 20.f, 50.f}) {
+                c.setAmount(a);
+                for (float x : grid(-1.f, 1.f)) out.push_back(c.value(x));
+            }
+
+            return out;
+        }},
+        {"ReShaperCurve_ADAA", GOLDEN_EXACT, []() {
+            std::vector<float> out;
+            ADAA<ReShaperCurve> s;
+
+            s.curve.setAmount(10.f);
+            s.update();
+
+            for (float x : testSignal(1.f)) out.push_back(s.process(x));
+
+            return out;
+        }},
+        {"ReShaperCurveSSE", GOLDEN_EXACT, []() {
+            std::vector<float> x = grid(-1.f, 1.f), out(GOLDEN_LENGTH);
+            ReShaperCurveSSE c;
+
+            c.setAmount(_mm_setr_ps(1.f, 5.f, 20.f, 50.f));
+
+            for (int i = 0; i < GOLDEN_LENGTH; i += 4) {
+                _mm_storeu_ps(&out[i], c.value(_mm_loadu_ps(&x[i])));
+            }
+
+            return out;
+        }},
+
+        /* DSPMath */
+        {"wrapTWOPI", GOLDEN_EXACT, []() { return mapGrid(-20.f, 20.f, wrapTWOPI); }},
+        {"fastSinWrap", GOLDEN_EXACT, []() { return mapGrid(-20.f, 20.f, fastSinWrap); }},
+        {"fastSin", GOLDEN_EXACT, []() { return mapGrid(-3.14f, 3.14f, fastSin); }},
+        {"qsinlp", GOLDEN_EXACT, []() { return mapGrid(-3.14f, 3.14f, qsinlp); }},
+        {"BLIT", GOLDEN_DIVIDING, []() { return mapGrid(0.01f, 6.27f, [](float x) { return BLIT(50.f, x); }); }},
+        {"shape1", GOLDEN_EXACT, []() { return mapGrid(-4.f, 4.f, [](float x) { return shape1(0.778f, x); }); }},
+        {"saturate", GOLDEN_EXACT, []() { return mapGrid(-2.f, 2.f, [](float x) { return saturate(x, 0.5); }); }},
+        {"overdrive", GOLDEN_EXACT, []() { return mapGrid(-3.f, 3.f, overdrive); }},
+        {"saturate2", GOLDEN_EXACT, []() { return mapGrid(-2.f, 2.f, saturate2); }},
+        {"fastTanh", GOLDEN_EXACT, []() { return mapGrid(-4.f, 4.f, fastTanh); }},
+        {"fastExp2", GOLDEN_EXACT, []() { return mapGrid(-13.f, 13.f, fastExp2); }},
+        {"fastLog", GOLDEN_EXACT, []() { return mapGrid(0.01f, 100.f, fastLog); }},
+        {"fastAtan", GOLDEN_EXACT, []() { return mapGrid(-10.f, 10.f, fastAtan); }},
+        {"sineTable", GOLDEN_EXACT, []() { return mapGrid(-2.f, 2.f, [](float x) { return sineTable.lookup(x); }); }},
+        {"polyBLEP", GOLDEN_DIVIDING, []() {
+            return mapGrid(0.f, 1.f, [](float t) { return polyBLEP(t, 0.01f, 100.f); });
+        }},
+        {"Randomizer", GOLDEN_EXACT, []() {
+            std::vector<float> out(GOLDEN_LENGTH);
+            Randomizer r(GOLDEN_SEED);
+
+            r.fill(out.data(), GOLDEN_LENGTH, -1.f, 1.f);
+            return out;
+        }},
+};
+
+
+/**
+ * @brief File of a golden signal
+ * @param dir
+ * @param name
+ * @return
+ */
+static std::string goldenPath(const std::string &dir, const char *name) {
+    return dir + "/" + name + ".f32";
+}
+
+
+/**
+ * @brief Write raw float samples, the byte order of the host is used, the committed files are little endian
+ * @param path
+ * @param x
+ * @return
+ */
+static bool writeSamples(const std::string &path, const std::vector<float> &x) {
+    FILE *f = fopen(path.c_str(), "wb");
+    if (!f) return false;
+
+    bool ok = fwrite(x.data(), sizeof(float), x.size(), f) == x.size();
+
+    return fclose(f) == 0 && ok;
+}
+
+
+/**
+ * @brief Read raw float samples written by writeSamples()
+ * @param path
+ * @param x
+ * @return
+ */
+static bool readSamples(const std::string &path, std::vector<float> &x) {
+    FILE *f = fopen(path.c_str(), "rb");
+    if (!f) return false;
+
+    x.clear();
+    float buffer[1024];
+    size_t n;
+
+    while ((n = fread(buffer, sizeof(float), 1024, f)) > 0) {
+        x.insert(x.end(), buffer, buffer + n);
+    }
+
+    fclose(f);
+    return true;
+}
+
+
+/**
+ * @brief Error of a render relative to the golden signal
+ * @param golden
+ * @param x
+ * @return dB, 0 if the lengths differ or the render has NaN or infinite samples
+ */
+static double errorLevel(const std::vector<float> &golden, const std::vector<float> &x) {
+    if (golden.size() != x.size()) return 0.;
+
+    double diff = 0., power = 0.;
+
+    for (size_t i = 0; i < x.size(); i++) {
+        if (!std::isfinite(x[i])) return 0.;
+
+        diff += ((double) x[i] - golden[i]) * ((double) x[i] - golden[i]);
+        power += (double) golden[i] * golden[i];
+    }
+
+    if (diff == 0.) return -INFINITY;
+
+    return 10. * log10(diff / fmax(power, 1e-30));
+}
+
+
+/**
+ * @brief Time of a fixed integer and float loop which does not depend on the DSP code
+ *
+ * Shared machines change their speed in steps, perf cases are timed relative to this loop right before
+ * them, so a slower machine does not look like a regression.
+ *
+ * @return ns per iteration
+ */
+static double calibrate() {
+    return bestTime(BENCH_SR, []() {
+        uint32_t s = 1;
+        float sum = 0.f;
+
+        for (int i = 0; i < BENCH_SR; i++) {
+            s ^= s << 13;
+            s ^= s >> 17;
+            s ^= s << 5;
+            sum = sum * 0.5f + (float) (s >> 8);
+        }
+
+        return sum;
+    });
+}
+
+
+/**
+ * @brief Timing of a perf case
+ */
+struct PerfTime {
+    double ns;       // ns per sample
+    double relative; // time relative to calibrate(), compared by verify
+};
+
+
+/**
+ * @brief Best time of a perf case at BENCH_SR over REGRESSION_ROUNDS rounds
+ * @param c
+ * @return
+ */
+static PerfTime timePerfCase(const PerfCase &c) {
+    PerfTime best = {1e9, 1e9};
+
+    for (int r = 0; r < REGRESSION_ROUNDS; r++) {
+        double cal = calibrate();
+        double ns = c.run(BENCH_SR);
+
+        if (ns / cal < best.relative) best = {ns, ns / cal};
+    }
+
+    return best;
+}
+
+
+/**
+ * @brief Render all golden signals into a directory
+ * @param dir Created if it does not exist
+ * @return 0 on success
+ */
+int recordGolden(const std::string &dir) {
+    if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) {
+        rack::warn("Unable to create %s", dir.c_str());
+        return 1;
+    }
+
+    for (const GoldenCase &c : goldenCases) {
+        std::vector<float> x = c.render();
+
+        if (!writeSamples(goldenPath(dir, c.name), x)) {
+            rack::warn("Unable to write %s", goldenPath(dir, c.name).c_str());
+            return 1;
+        }
+
+        printf("%-24s %8d samples\n", c.name, (int) x.size());
+    }
+
+    printf("\ngolden signals recorded in %s\n", dir.c_str());
+
+    return 0;
+}
+
+
+/**
+ * @brief Compare all golden signals against a directory and print the error of every case
+ * @param dir Directory written by recordGolden()
+ * @return Number of cases out of tolerance or missing
+ */
+static int compareGolden(const std::string &dir) {
+    int failed = 0;
+
+    printf("%-24s %10s %10s\n", "golden", "error dB", "limit dB");
+
+    for (const GoldenCase &c : goldenCases) {
+        std::vector<float> golden;
+
+        if (!readSamples(goldenPath(dir, c.name), golden)) {
+            printf("%-24s %10s\n", c.name, "missing");
+            failed++;
+            continue;
+        }
+
+        double err = errorLevel(golden, c.render());
+        bool ok = err <= c.tolerance;
+
+        printf("%-24s %10.1f %10.1f  %s\n", c.name, err, c.tolerance, ok ? "ok" : "FAILED");
+        if (!ok) failed++;
+    }
+
+    return failed;
+}
+
+
+/**
+ * @brief Compare all golden signals against a directory
+ * @param dir Directory written by recordGolden()
+ * @return 0 if all signals are within their tolerance
+ */
+int verifyGolden(const std::string &dir) {
+    int failed = compareGolden(dir);
+
+    printf("\n");
+
+    if (failed) {
+        printf("%d golden signals out of tolerance\n", failed);
+        return 1;
+    }
+
+    printf("all golden signals ok\n");
+    return 0;
+}
+
+
+/**
+ * @brief Time all perf cases into a directory, the golden signals are not touched
+ * @param dir Created if it does not exist
+ * @return 0 on success
+ */
+int recordRegression(const std::string &dir) {
+    if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) {
+        rack::warn("Unable to create %s", dir.c_str());
+        return 1;
+    }
+
+    std::string path = dir + "/" REGRESSION_PERF_FILE;
+    FILE *f = fopen(path.c_str(), "w");
+
+    if (!f) {
+        rack::warn("Unable to write %s", path.c_str());
+        return 1;
+    }
+
+    for (const PerfCase &c : perfCases()) {
+        PerfTime t = timePerfCase(c);
+
+        fprintf(f, "%.4f\t%.6f\t%s\n", t.ns, t.relative, c.name);
+        printf("%-24s %8.2f ns\n", c.name, t.ns);
+    }
+
+    fclose(f);
+    printf("\nbaseline recorded in %s\n", dir.c_str());
+
+    return 0;
+}
+
+
+/**
+ * @brief Compare the golden signals of LRT_GOLDEN_DIR and all perf cases against a recorded baseline
+ * @param dir Directory written by recordRegression()
+ * @param slowdown Highest accepted slowdown of a perf case in percent
+ * @return 0 if nothing regressed
+ */
+int verifyRegression(const std::string &dir, double slowdown) {
+    int failed = compareGolden(LRT_GOLDEN_DIR);
+
+    /* baseline timings by name, cases added since the recording are only reported */
+    std::string path = dir + "/" REGRESSION_PERF_FILE;
+    FILE *f = fopen(path.c_str(), "r");
+
+    if (!f) {
+        rack::warn("Unable to read %s", path.c_str());
+        return 1;
+    }
+
+    std::vector<std::pair<std::string, PerfTime>> baseline;
+    char line[256];
+
+    while (fgets(line, sizeof(line), f)) {
+        char name[200];
+        PerfTime t;
+
+        if (sscanf(line, "%lf\t%lf\t%199[^\n]", &t.ns, &t.relative, name) == 3) {
+            baseline.push_back(std::make_pair(name, t));
+        }
+    }
+
+    fclose(f);
+
+    printf("\n%-24s %10s %10s %10s\n", "perf", "base ns", "ns", "change %");
+
+    for (const PerfCase &c : perfCases()) {
+        const PerfTime *base = nullptr;
+
+        for (const std::pair<std::string, PerfTime> &b : baseline) {
+            if (b.first == c.name) base = &b.second;
+        }
+
+        PerfTime t = timePerfCase(c);
+
+        if (!base) {
+            printf("%-24s %10s %10.2f %10s  new\n", c.name, "-", t.ns, "-");
+            continue;
+        }
+
+        /* load of other processes comes in bursts, let it pass and time again before counting it */
+        for (int r = 0; r < REGRESSION_RETRIES && t.relative > base->relative * (1. + slowdown / 100.); r++) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+            PerfTime again = timePerfCase(c);
+            if (again.relative < t.relative) t = again;
+        }
+
+        double change = (t.relative / base->relative - 1.) * 100.;
+        bool ok = change <= slowdown;
+
+        printf("%-24s %10.2f %10.2f %+10.1f  %s\n", c.name, base->ns, t.ns, change, ok ? "ok" : "SLOWER");
+        if (!ok) failed++;
+    }
+
+    printf("\n");
+
+    if (failed) {
+        printf("%d regressions, limits are the golden tolerances and %.0f%% slowdown\n", failed, slowdown);
+        return 1;
+    }
+
+    printf("no regressions\n");
+    return 0;
+}
@@ -0,0 +1,198 @@
+/**
+ * Accuracy, aliasing and CPU of the ADAA waveshapers in src/dsp/Waveshaper.hpp, suite "waveshaper" of lrt_bench
+ */
+
+#include <functional>
+#include "Bench.hpp"
+#include "Waveshaper.hpp"
+
+#define BENCH_FREQ 2489 // whole Hz, aliases fall between the harmonics
+
+
+/**
+ * @brief Reference curve and antiderivative in double precision
+ */
+struct Reference {
+    std::function<double(double)> f;
+    std::function<double(double)> F;
+};
+
+
+/**
+ * @brief Numerical antiderivative from 0 with Simpson's rule, for curves without closed form
+ * @param f
+ * @param x
+ * @return
+ */
+static double integrate(const std::function<double(double)> &f, double x) {
+    const int n = 2048;
+    double h = x / n, s = f(0) + f(x);
+
+    for (int i = 1; i < n; i++) s += (i & 1 ? 4 : 2) * f(i * h);
+
+    return s * h / 3;
+}
+
+
+/**
+ * @brief Measure one curve and print a table row
+ * @param name
+ * @param amp Peak input level
+ * @param ref Reference in double precision
+ * @param curve Scalar curve with the parameters set
+ * @param curveSSE SSE curve with the same parameters
+ */
+template<typename CURVE, typename CURVESSE>
+static void measure(const char *name, double amp, const Reference &ref, const CURVE &curve, const CURVESSE &curveSSE) {
+    std::vector<float> in(BENCH_SR);
+
+    for (int i = 0; i < BENCH_SR; i++) in[i] = (float) (amp * sin(2 * M_PI * BENCH_FREQ * i / BENCH_SR));
+
+    /* accuracy of the fast curve and antiderivative over the input range */
+    double errF = 0, errA = 0;
+
+    for (int i = -1000; i <= 1000; i++) {
+        double x = amp * i / 1000.;
+
+        errF = fmax(errF, fabs(curve.value((float) x) - ref.f(x)));
+        errA = fmax(errA, fabs(curve.antiderivative((float) x) - ref.F(x)));
+    }
+
+    /* ADAA against ADAA in double precision */
+    std::vector<double> naive(BENCH_SR), adaa(BENCH_SR), exact(BENCH_SR);
+    ADAA<CURVE> stage;
+    double x1 = 0, F1 = ref.F(0), errADAA = 0;
+
+    stage.curve = curve;
+    stage.update();
+
+    for (int i = 0; i < BENCH_SR; i++) {
+        double x = in[i], F = ref.F(x);
+
+        exact[i] = fabs(x - x1) > 1e-9 ? (F - F1) / (x - x1) : ref.f(0.5 * (x + x1));
+        x1 = x;
+        F1 = F;
+
+        naive[i] = ref.f(x);
+        adaa[i] = stage.process(in[i]);
+
+        errADAA = fmax(errADAA, fabs(adaa[i] - exact[i]));
+    }
+
+    /* SSE stage with the signal in every lane against the scalar stage */
+    ADAASSE<CURVESSE> stageSSE;
+    double errSSE = 0;
+
+    stageSSE.curve = curveSSE;
+    stageSSE.update();
+
+    for (int i = 0; i < BENCH_SR; i++) {
+        float v[4];
+        _mm_storeu_ps(v, stageSSE.process(_mm_set1_ps(in[i])));
+
+        for (int k = 0; k < 4; k++) errSSE = fmax(errSSE, fabs(v[k] - adaa[i]));
+    }
+
+    /* CPU per sample */
+    const float *x = in.data();
+    const int n = BENCH_SR;
+
+    double tRef = bestTime(n, [&]() {
+        float s = 0.f;
+        for (int i = 0; i < n; i++) s += (float) ref.f(x[i]);
+        return s;
+    });
+
+    double tFast = bestTime(n, [&]() {
+        float s = 0.f;
+        for (int i = 0; i < n; i++) s += curve.value(x[i]);
+        return s;
+    });
+
+    double tADAA = bestTime(n, [&]() {
+        ADAA<CURVE> a;
+        float s = 0.f;
+
+        a.curve = curve;
+        for (int i = 0; i < n; i++) s += a.process(x[i]);
+        return s;
+    });
+
+    double tSSE = bestTime(n, [&]() {
+        ADAASSE<CURVESSE> a;
+        __m128 s = _mm_setzero_ps();
+
+        a.curve = curveSSE;
+        for (int i = 0; i + 4 <= n; i += 4) s = _mm_add_ps(s, a.process(_mm_loadu_ps(x + i)));
+        return _mm_cvtss_f32(s);
+    });
+
+    printf("%-20s %8.1e %8.1e %8.1e %8.1e   %6.1f %6.1f   %5.1f %5.1f %5.1f %5.2f\n", name, errF, errA, errADAA,
+           errSSE, aliasLevel(naive, BENCH_FREQ, BENCH_SR), aliasLevel(adaa, BENCH_FREQ, BENCH_SR),
+           tRef, tFast, tADAA, tSSE);
+}
+
+
+int waveshaperBench() {
+    printf("%-20s %8s %8s %8s %8s   %6s %6s   %5s %5s %5s %5s\n", "", "f err", "F err", "ADAA err",
+           "SSE err", "alias", "ADAA", "ref", "fast", "ADAA", "SSE");
+    printf("%-20s %8s %8s %8s %8s   %6s %6s   %5s %5s %5s %5s\n", "", "", "", "", "", "dB", "dB", "ns", "ns", "ns", "ns");
+
+    {
+        float a = 0.778f;
+        Shape1Curve c;
+        Shape1CurveSSE cs;
+        c.setAmount(a);
+        cs.setAmount(_mm_set1_ps(a));
+
+        double k = 2. * a / (1. - a), g = 2 * (1 + k), h = k / 2;
+        Reference ref = {[a](double x) { return (double) shape1(a, (float) x); },
+                         [g, h](double x) { return g / h * (fabs(x) - log1p(h * fabs(x)) / h); }};
+
+        measure("shape1 0.778 x4", 4., ref, c, cs);
+    }
+
+    {
+        double a = 0.5;
+        SaturateCurve c;
+        SaturateCurveSSE cs;
+        c.setAmount((float) a);
+        cs.setAmount(_mm_set1_ps((float) a));
+
+        Reference ref = {[a](double x) { return saturate(x, a); },
+                         [a](double x) {
+                             double ax = fabs(x);
+                             if (ax <= a) return 0.5 * x * x;
+                             double u = (ax - a) / (1 - a);
+                             return a * (ax - 0.5 * a) + 0.5 * (1 - a) * (1 - a) * log1p(u * u);
+                         }};
+
+        measure("saturate 0.5 x2", 2., ref, c, cs);
+    }
+
+    {
+        OverdriveCurve c;
+        OverdriveCurveSSE cs;
+
+        Reference ref = {[](double x) { return overdrive(x); },
+                         [](double x) { return integrate(overdrive, x); }};
+
+        measure("overdrive x3", 3., ref, c, cs);
+    }
+
+    for (float a : {2.f, 3.f, 10.f, 50.f}) {
+        ReShaperCurve c;
+        ReShaperCurveSSE cs;
+        c.setAmount(a);
+        cs.setAmount(_mm_set1_ps(a));
+
+        auto f = [a](double x) { return x * (fabs(x) + a) / (x * x + (a - 1) * fabs(x) + 1); };
+        Reference ref = {f, [f](double x) { return integrate(f, fabs(x)); }};
+
+        char name[32];
+        snprintf(name, sizeof(name), "reshaper %.0f x1", a);
+        measure(name, 1., ref, c, cs);
+    }
+
+    return 0;
+}
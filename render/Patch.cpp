@@ -0,0 +1,341 @@
+#include <cerrno>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include "DSPHost.hpp"
+#include "Patch.hpp"
+
+
+/**
+ * @brief Parse a float, the whole text has to be a number
+ * @param text
+ * @param value
+ * @return
+ */
+static bool parseFloat(const std::string &text, float &value) {
+    char *end;
+    errno = 0;
+
+    float v = strtof(text.c_str(), &end);
+
+    if (text.empty() || *end != 0 || errno != 0 || v != v) return false;
+
+    value = v;
+    return true;
+}
+
+
+/**
+ * @brief Parse a non-negative integer, the whole text has to be a number
+ * @param text
+ * @param value
+ * @return
+ */
+static bool parseUInt(const std::string &text, uint32_t &value) {
+    char *end;
+    errno = 0;
+
+    unsigned long v = strtoul(text.c_str(), &end, 10);
+
+    if (text.empty() || text[0] == '-' || *end != 0 || errno != 0 || v > 0xFFFFFFFFUL) return false;
+
+    value = (uint32_t) v;
+    return true;
+}
+
+
+/**
+ * @brief Look up a name in a list of choices
+ * @param text
+ * @param names Null terminated
+ * @param values Value of every name
+ * @param value
+ * @return
+ */
+static bool parseChoice(const std::string &text, const char *const *names, const int *values, int &value) {
+    for (int i = 0; names[i]; i++) {
+        if (text == names[i]) {
+            value = values[i];
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+/**
+ * @brief Remove leading and trailing whitespace
+ * @param text
+ * @return
+ */
+static std::string trim(const std::string &text) {
+    size_t a = text.find_first_not_of(" \t\r\n");
+    if (a == std::string::npos) return "";
+
+    size_t b = text.find_last_not_of(" \t\r\n");
+    return text.substr(a, b - a + 1);
+}
+
+
+/**
+ * @brief Parse a constant or breakpoints "time:value" separated by whitespace or commas
+ * @param text
+ * @return false on syntax errors or times going backwards
+ */
+bool Automation::parse(const std::string &text) {
+    std::string list = text;
+
+    for (char &c : list) {
+        if (c == ',') c = ' ';
+    }
+
+    std::istringstream in(list);
+    std::vector<std::pair<float, float>> parsed;
+    std::string token;
+
+    while (in >> token) {
+        size_t colon = token.find(':');
+        float t = 0.f, v;
+
+        if (colon == std::string::npos) {
+            /* a single value without time is a constant */
+            if (!parsed.empty() || !parseFloat(token, v)) return false;
+        } else if (!parseFloat(token.substr(0, colon), t) || !parseFloat(token.substr(colon + 1), v)) {
+            return false;
+        }
+
+        if (!parsed.empty() && (colon == std::string::npos || t < parsed.back().first)) return false;
+
+        parsed.push_back(std::make_pair(t, v));
+    }
+
+    if (parsed.empty()) return false;
+
+    points = parsed;
+    return true;
+}
+
+
+/**
+ * @brief Value at a point in time
+ * @param t Seconds
+ * @return
+ */
+float Automation::value(float t) const {
+    if (t <= points.front().first) return points.front().second;
+
+    for (size_t k = 1; k < points.size(); k++) {
+        if (t < points[k].first) {
+            const std::pair<float, float> &a = points[k - 1], &b = points[k];
+            return a.second + (b.second - a.second) * (t - a.first) / (b.first - a.first);
+        }
+    }
+
+    return points.back().second;
+}
+
+
+/**
+ * @brief Values of a block of samples
+ * @param t Time of the first sample in seconds
+ * @param dt Time between samples
+ * @param out
+ * @param n
+ */
+void Automation::fill(float t, float dt, float *out, int n) const {
+    if (isConstant()) {
+        for (int i = 0; i < n; i++) out[i] = points[0].second;
+        return;
+    }
+
+    /* the segment only moves forward within a block */
+    size_t k = 1;
+
+    for (int i = 0; i < n; i++) {
+        float ti = t + i * dt;
+
+        while (k < points.size() && ti >= points[k].first) k++;
+
+        if (k == points.size()) {
+            out[i] = points.back().second;
+        } else if (ti <= points[k - 1].first) {
+            out[i] = points[k - 1].second;
+        } else {
+            const std::pair<float, float> &a = points[k - 1], &b = points[k];
+            out[i] = a.second + (b.second - a.second) * (ti - a.first) / (b.first - a.first);
+        }
+    }
+}
+
+
+/**
+ * @brief True if the value never changes
+ * @return
+ */
+bool Automation::isConstant() const {
+    return points.size() == 1;
+}
+
+
+/**
+ * @brief Set one key of a patch
+ * @param patch
+ * @param key
+ * @param value
+ * @return false on unknown keys or invalid values
+ */
+static bool setKey(Patch &patch, const std::string &key, const std::string &value) {
+    static const char *const cores[] = {"blit", "blep", "wavetable", nullptr};
+    static const int coreValues[] = {PATCH_CORE_BLIT, PATCH_CORE_BLEP, PATCH_CORE_WAVETABLE};
+    static const char *const waves[] = {"saw", "pulse", "sawtri", "tri", nullptr};
+    static const int waveValues[] = {PATCH_WAVE_SAW, PATCH_WAVE_PULSE, PATCH_WAVE_SAWTRI, PATCH_WAVE_TRI};
+    static const char *const filters[] = {"off", "classic", "zdf", nullptr};
+    static const int filterValues[] = {PATCH_FILTER_OFF, PATCH_FILTER_CLASSIC, PATCH_FILTER_ZDF};
+    static const char *const outputs[] = {"lp", "hp", "bp", nullptr};
+    static const int outputValues[] = {PATCH_OUTPUT_LP, PATCH_OUTPUT_HP, PATCH_OUTPUT_BP};
+    static const char *const shapers[] = {"off", "1x", "2x", "4x", "8x", "adaa", nullptr};
+    static const int shaperValues[] = {PATCH_SHAPER_OFF, 1, 2, 4, 8, PATCH_SHAPER_ADAA};
+    static const char *const formats[] = {"16", "24", "float", nullptr};
+    static const int formatValues[] = {16, 24, 32};
+
+    uint32_t u;
+
+    if (key == "out") {
+        patch.out = value;
+        return !value.empty();
+    }
+
+    if (key == "length") return parseFloat(value, patch.length) && patch.length > 0.f;
+
+    if (key == "samplerate") {
+        if (!parseUInt(value, u) || u < 8000 || u > 768000) return false;
+        patch.sampleRate = (int) u;
+        return true;
+    }
+
+    if (key == "format") return parseChoice(value, formats, formatValues, patch.format);
+
+    if (key == "seed") return parseUInt(value, patch.seed);
+
+    if (key == "vco.core") return parseChoice(value, cores, coreValues, patch.core);
+    if (key == "vco.wave") return parseChoice(value, waves, waveValues, patch.wave);
+
+    if (key == "vco.wavetable") {
+        patch.wavetable = value;
+        return !value.empty();
+    }
+
+    if (key == "vco.pitch") return patch.pitch.parse(value);
+    if (key == "vco.octave") return patch.octave.parse(value);
+    if (key == "vco.pw") return patch.pw.parse(value);
+    if (key == "vco.shape") return patch.shape.parse(value);
+    if (key == "vco.position") return patch.position.parse(value);
+
+    if (key == "filter.core") return parseChoice(value, filters, filterValues, patch.filter);
+
+    if (key == "filter.oversampling") {
+        if (!parseUInt(value, u) || (u != 2 && u != 4 && u != 8 && u != 16)) return false;
+        patch.oversampling = (int) u;
+        return true;
+    }
+
+    if (key == "filter.controlrate") {
+        if (!parseUInt(value, u) || u > 65536) return false;
+        patch.controlRate = (int) u;
+        return true;
+    }
+
+    if (key == "filter.output") return parseChoice(value, outputs, outputValues, patch.output);
+    if (key == "filter.cutoff") return patch.cutoff.parse(value);
+    if (key == "filter.resonance") return patch.resonance.parse(value);
+    if (key == "filter.drive") return patch.drive.parse(value);
+
+    if (key == "shaper.quality") return parseChoice(value, shapers, shaperValues, patch.shaper);
+    if (key == "shaper.amount") return patch.amount.parse(value);
+
+    if (key == "gain") return patch.gain.parse(value);
+
+    return false;
+}
+
+
+/**
+ * @brief Read a patch file, one render per [name] section
+ *
+ * Keys before the first section are defaults of all sections, a file without sections is one render
+ * named after the file. Comments start with # or ;, relative wavetable paths start at the patch file.
+ *
+ * @param path
+ * @param patches Renders of the file are appended
+ * @return false if the file can not be read or has errors, every error is reported with warn()
+ */
+bool loadPatches(const std::string &path, std::vector<Patch> &patches) {
+    std::ifstream in(path.c_str());
+
+    if (!in) {
+        rack::warn("Unable to open patch %s", path.c_str());
+        return false;
+    }
+
+    Patch defaults;
+    std::vector<Patch> parsed;
+    std::string line;
+    bool ok = true;
+
+    for (int number = 1; std::getline(in, line); number++) {
+        size_t comment = line.find_first_of("#;");
+        if (comment != std::string::npos) line.erase(comment);
+
+        line = trim(line);
+        if (line.empty()) continue;
+
+        if (line[0] == '[') {
+            std::string name = line.back() == ']' ? trim(line.substr(1, line.size() - 2)) : "";
+
+            if (name.empty()) {
+                rack::warn("%s:%d: invalid section %s", path.c_str(), number, line.c_str());
+                ok = false;
+                continue;
+            }
+
+            parsed.push_back(defaults);
+            parsed.back().name = name;
+            continue;
+        }
+
+        size_t eq = line.find('=');
+        std::string key = trim(line.substr(0, eq));
+        std::string value = eq == std::string::npos ? "" : trim(line.substr(eq + 1));
+
+        if (eq == std::string::npos || !setKey(parsed.empty() ? defaults : parsed.back(), key, value)) {
+            rack::warn("%s:%d: invalid setting %s", path.c_str(), number, line.c_str());
+            ok = false;
+        }
+    }
+
+    size_t slash = path.find_last_of('/');
+    std::string dir = slash == std::string::npos ? "" : path.substr(0, slash + 1);
+
+    if (parsed.empty()) {
+        std::string name = path.substr(dir.size());
+        size_t dot = name.rfind('.');
+
+        defaults.name = dot == 0 || dot == std::string::npos ? name : name.substr(0, dot);
+        parsed.push_back(defaults);
+    }
+
+    for (Patch &p : parsed) {
+        /* wavetables are found next to the patch */
+        if (!p.wavetable.empty() && p.wavetable[0] != '/') p.wavetable = dir + p.wavetable;
+
+        if (p.core == PATCH_CORE_WAVETABLE && p.wavetable.empty()) {
+            rack::warn("%s: [%s] the wavetable core needs vco.wavetable", path.c_str(), p.name.c_str());
+            ok = false;
+        }
+    }
+
+    if (ok) patches.insert(patches.end(), parsed.begin(), parsed.end());
+
+    return ok;
+}
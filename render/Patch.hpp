@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+/* oscillator cores, same order as the VCO module */
+#define PATCH_CORE_BLIT 0
+#define PATCH_CORE_BLEP 1
+#define PATCH_CORE_WAVETABLE 2
+
+/* filter cores, same order as the VCF module */
+#define PATCH_FILTER_OFF -1
+#define PATCH_FILTER_CLASSIC 0
+#define PATCH_FILTER_ZDF 1
+
+#define PATCH_OUTPUT_LP 0
+#define PATCH_OUTPUT_HP 1
+#define PATCH_OUTPUT_BP 2
+
+/* rendered waveform of the BLIT and BLEP cores */
+#define PATCH_WAVE_SAW 0
+#define PATCH_WAVE_PULSE 1
+#define PATCH_WAVE_SAWTRI 2
+#define PATCH_WAVE_TRI 3
+
+#define PATCH_SHAPER_OFF -1
+#define PATCH_SHAPER_ADAA 0 // otherwise the oversampling factor, see ReShaper
+
+
+/**
+ * @brief Parameter automation, linear between breakpoints and constant before the first and after the last
+ */
+struct Automation {
+    std::vector<std::pair<float, float>> points; // time in seconds and value, sorted by time
+
+
+    /**
+     * @brief Constant value
+     * @param value
+     */
+    Automation(float value = 0.f) {
+        points.push_back(std::make_pair(0.f, value));
+    }
+
+
+    bool parse(const std::string &text);
+    float value(float t) const;
+    void fill(float t, float dt, float *out, int n) const;
+    bool isConstant() const;
+};
+
+
+/**
+ * @brief One render: oscillator into filter into ReShaper, written to a mono WAV file
+ *
+ * Values follow the knobs of the modules: pitch and octave in volts (0 V is C4), cutoff 0..1, resonance
+ * 0..1.5, drive 0..1, ReShaper amount 1..50. The output is scaled from Rack voltage, 10 V is full scale.
+ */
+struct Patch {
+    std::string name;
+    std::string out;          // output file, <name>.wav if empty
+    float length = 1.f;       // seconds
+    int sampleRate = 44100;
+    int format = 24;          // 16, 24 or 32 for float
+    uint32_t seed = 0;        // analogue detune and filter noise, renders are reproducible
+
+    int core = PATCH_CORE_BLIT;
+    int wave = PATCH_WAVE_SAW;
+    std::string wavetable;
+    Automation pitch, octave, pw = Automation(1.f), shape = Automation(1.f), position;
+
+    int filter = PATCH_FILTER_OFF;
+    int oversampling = 0;     // 0 uses the default of the core
+    int controlRate = 0;      // samples between coefficient updates of the classic core, 0 tracks at audio rate
+    int output = PATCH_OUTPUT_LP;
+    Automation cutoff = Automation(1.f), resonance, drive;
+
+    int shaper = PATCH_SHAPER_OFF;
+    Automation amount = Automation(1.f);
+
+    Automation gain = Automation(1.f);
+};
+
+
+bool loadPatches(const std::string &path, std::vector<Patch> &patches);
@@ -0,0 +1,150 @@
+/**
+ * lrt_render, offline renderer of oscillator, filter and ReShaper chains without Rack
+ *
+ * Every patch file holds one or more renders, see Patch.hpp and render/example.patch. All renders are
+ * independent and run in parallel on a thread pool, every one is streamed to its own WAV file:
+ *   cmake -S . -B build && cmake --build build --target lrt_render
+ *   build/lrt_render -j 8 -o out render/example.patch
+ */
+
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <mutex>
+#include <set>
+#include <sys/stat.h>
+#include "DSPHost.hpp"
+#include "Renderer.hpp"
+#include "ThreadPool.hpp"
+
+
+/**
+ * @brief Print usage
+ * @param name Name of the executable
+ */
+static void usage(const char *name) {
+    printf("usage: %s [-j threads] [-o directory] patch...\n\n", name);
+    printf("  -j threads    renders in parallel, default one per hardware thread\n");
+    printf("  -o directory  directory of relative output files, created if missing, default the current one\n");
+}
+
+
+/**
+ * @brief Value of a single letter option, attached as in -j8 or in the next argument as in -j 8
+ * @param opt Option letter
+ * @param argc
+ * @param argv
+ * @param i Index of the current argument, advanced past a separate value
+ * @return nullptr if argv[i] is not the option or the value is missing
+ */
+static const char *optionValue(char opt, int argc, char **argv, int &i) {
+    if (argv[i][0] != '-' || argv[i][1] != opt) return nullptr;
+    if (argv[i][2] != '\0') return argv[i] + 2;
+    if (i + 1 < argc) return argv[++i];
+
+    return nullptr;
+}
+
+
+int main(int argc, char **argv) {
+    std::vector<std::string> files;
+    std::string dir;
+    int threads = 0;
+
+    for (int i = 1; i < argc; i++) {
+        const char *value;
+
+        if ((value = optionValue('j', argc, argv, i))) {
+            threads = atoi(value);
+        } else if ((value = optionValue('o', argc, argv, i))) {
+            dir = value;
+        } else if (argv[i][0] == '-') {
+            usage(argv[0]);
+            return 2;
+        } else {
+            files.push_back(argv[i]);
+        }
+    }
+
+    if (files.empty()) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    /* nothing is rendered unless all patches are valid */
+    std::vector<Patch> patches;
+    bool ok = true;
+
+    for (const std::string &file : files) {
+        ok = loadPatches(file, patches) && ok;
+    }
+
+    if (!ok) return 1;
+
+    /* the output directory may not exist yet on a fresh build box, its parent has to */
+    if (!dir.empty() && mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) {
+        rack::warn("Unable to create %s", dir.c_str());
+        return 1;
+    }
+
+    std::vector<std::string> paths;
+    std::set<std::string> unique;
+
+    for (const Patch &p : patches) {
+        std::string out = p.out.empty() ? p.name + ".wav" : p.out;
+        if (!dir.empty() && out[0] != '/') out = dir + "/" + out;
+
+        if (!unique.insert(out).second) {
+            rack::warn("%s is the output of more than one render", out.c_str());
+            ok = false;
+        }
+
+        paths.push_back(out);
+    }
+
+    if (!ok) return 1;
+
+    std::mutex print;
+    int failed = 0;
+    double audio = 0., busy = 0.;
+
+    auto t0 = std::chrono::steady_clock::now();
+
+    {
+        ThreadPool pool(threads);
+        printf("rendering %d patches on %d threads\n", (int) patches.size(), pool.size());
+
+        for (size_t i = 0; i < patches.size(); i++) {
+            pool.submit([&, i]() {
+                RenderResult r = renderPatch(patches[i], paths[i]);
+                double seconds = (double) r.frames / patches[i].sampleRate;
+
+                std::lock_guard<std::mutex> lock(print);
+
+                if (r.ok) {
+                    printf("  %-32s %8.2f s  %8.1fx real time\n", paths[i].c_str(), seconds, seconds / r.seconds);
+                } else {
+                    printf("  %-32s failed\n", paths[i].c_str());
+                    failed++;
+                }
+
+                audio += seconds;
+                busy += r.seconds;
+            });
+        }
+
+        pool.wait();
+    }
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    printf("%.2f s of audio in %.2f s, %.1fx real time, %.1fx per thread\n", audio, elapsed, audio / elapsed,
+           busy > 0. ? audio / busy : 0.);
+
+    if (failed) {
+        printf("%d of %d renders failed\n", failed, (int) patches.size());
+        return 1;
+    }
+
+    return 0;
+}
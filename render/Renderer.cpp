@@ -0,0 +1,318 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include "Oscillator.hpp"
+#include "BLEPOscillator.hpp"
+#include "WavetableOscillator.hpp"
+#include "LadderFilter.hpp"
+#include "ZDFLadderFilter.hpp"
+#include "Waveshaper.hpp"
+#include "Oversampler.hpp"
+#include "Renderer.hpp"
+#include "WavWriter.hpp"
+
+using namespace rack;
+
+
+/**
+ * @brief Oscillator, filter and ReShaper of one render, processed in blocks of RENDER_BLOCKSIZE samples
+ *
+ * Levels and parameter mappings follow the VCO, VCF and ReShaper modules, so a render sounds like the
+ * same patch in Rack. Every object gets the sample rate and the seed of the patch, so renders running in
+ * parallel do not depend on each other or on the engine.
+ */
+struct RenderChain {
+    const Patch &patch;
+
+    BLITOscillator blit;
+    BLEPOscillator blep;
+    WavetableOscillator wavetable;
+    float shape = -1.f;
+
+    LadderFilter ladder;
+    ZDFLadderFilter zdf;
+
+    ADAA<ReShaperCurve> shaper;
+    Oversampler<1> os;
+
+    /* automation of the current block */
+    float pitch[RENDER_BLOCKSIZE], octave[RENDER_BLOCKSIZE], cutoff[RENDER_BLOCKSIZE], gain[RENDER_BLOCKSIZE];
+    float lp[RENDER_BLOCKSIZE], hp[RENDER_BLOCKSIZE], bp[RENDER_BLOCKSIZE];
+
+
+    explicit RenderChain(const Patch &patch) : patch(patch) {}
+
+    bool init();
+    void process(float t, float *out, int n);
+
+    template<typename OSC>
+    void processCore(OSC &core, float t, float *out, int n);
+    void processWavetable(float t, float *out, int n);
+
+    template<typename FILTER>
+    void processFilter(FILTER &filter, float t, float *io, int n);
+    void processShaper(float t, float *io, int n);
+};
+
+
+/**
+ * @brief Apply sample rate, seed and the fixed settings of the patch
+ * @return false if the wavetable can not be loaded
+ */
+bool RenderChain::init() {
+    static const int masks[] = {OSC_WAVE_SAW, OSC_WAVE_PULSE, OSC_WAVE_SAWTRI, OSC_WAVE_TRI};
+    float sr = (float) patch.sampleRate;
+
+    blit.setSeed(patch.seed);
+    blit.setFixedPhase(true);
+    blit.setSampleRate(sr);
+    blit.setWaveMask(masks[patch.wave]);
+
+    /* same pitch on both cores, as in the VCO module */
+    blep.detune = blit.detune;
+    blep.setSampleRate(sr);
+    blep.setWaveMask(masks[patch.wave]);
+
+    if (patch.core == PATCH_CORE_WAVETABLE) {
+        std::shared_ptr<const Wavetable> table = WavetableCache::load(patch.wavetable);
+        if (!table) return false;
+
+        wavetable.setSampleRate(sr);
+        wavetable.setTable(table);
+    }
+
+    ladder.setSampleRate(sr);
+    ladder.setSeed(patch.seed);
+    ladder.setOversampling(patch.oversampling ? patch.oversampling : 8);
+    ladder.setControlRate(patch.controlRate);
+
+    zdf.setSampleRate(sr);
+    zdf.setOversampling(patch.oversampling ? patch.oversampling : ZDF_OVERSAMPLE);
+
+    if (patch.shaper > 1) os.setFactor(patch.shaper);
+
+    shaper.curve.setAmount(clampf(patch.amount.value(0.f), 1.f, 50.f));
+    shaper.update();
+
+    return true;
+}
+
+
+/**
+ * @brief Render one block
+ * @param t Time of the first sample in seconds
+ * @param out Output scaled to -1..1 at 10 V
+ * @param n 1..RENDER_BLOCKSIZE
+ */
+void RenderChain::process(float t, float *out, int n) {
+    switch (patch.core) {
+        case PATCH_CORE_WAVETABLE:
+            processWavetable(t, out, n);
+            break;
+        case PATCH_CORE_BLEP:
+            processCore(blep, t, out, n);
+            break;
+        default:
+            processCore(blit, t, out, n);
+    }
+
+    if (patch.filter == PATCH_FILTER_ZDF) {
+        processFilter(zdf, t, out, n);
+    } else if (patch.filter == PATCH_FILTER_CLASSIC) {
+        processFilter(ladder, t, out, n);
+    }
+
+    if (patch.shaper != PATCH_SHAPER_OFF) processShaper(t, out, n);
+
+    patch.gain.fill(t, 1.f / patch.sampleRate, gain, n);
+
+    for (int i = 0; i < n; i++) {
+        out[i] *= 0.1f * gain[i];
+    }
+}
+
+
+/**
+ * @brief Render the selected waveform of the BLIT or BLEP core
+ * @param core
+ * @param t
+ * @param out Rack voltage
+ * @param n
+ */
+template<typename OSC>
+void RenderChain::processCore(OSC &core, float t, float *out, int n) {
+    float dt = 1.f / patch.sampleRate;
+
+    patch.pitch.fill(t, dt, pitch, n);
+    patch.octave.fill(t, dt, octave, n);
+
+    float pw = patch.pw.value(t);
+    if (core.pw != pw) core.setPulseWidth(pw);
+
+    float s = patch.shape.value(t);
+
+    if (shape != s) {
+        shape = s;
+        blit.setSaturate(quadraticBipolar(s));
+    }
+
+    for (int i = 0; i < n; i++) {
+        core.updatePitch(pitch[i], 0.f, 0.f, octave[i]);
+        core.proccess();
+
+        switch (patch.wave) {
+            case PATCH_WAVE_PULSE:
+                out[i] = core.getPulseWave();
+                break;
+            case PATCH_WAVE_SAWTRI:
+                out[i] = core.getSawTriWave();
+                break;
+            case PATCH_WAVE_TRI:
+                out[i] = core.getTriangleWave();
+                break;
+            default:
+                out[i] = core.getSawWave();
+        }
+    }
+}
+
+
+/**
+ * @brief Render the wavetable core
+ * @param t
+ * @param out Rack voltage
+ * @param n
+ */
+void RenderChain::processWavetable(float t, float *out, int n) {
+    float dt = 1.f / patch.sampleRate;
+
+    patch.pitch.fill(t, dt, pitch, n);
+    patch.octave.fill(t, dt, octave, n);
+
+    wavetable.setPosition(patch.position.value(t));
+
+    for (int i = 0; i < n; i++) {
+        wavetable.updatePitch(pitch[i], 0.f, 0.f, octave[i]);
+        wavetable.proccess();
+
+        out[i] = wavetable.getOut();
+    }
+}
+
+
+/**
+ * @brief Run a block through the filter, as in SimpleFilter::processBlock()
+ * @param filter
+ * @param t
+ * @param io Rack voltage
+ * @param n
+ */
+template<typename FILTER>
+void RenderChain::processFilter(FILTER &filter, float t, float *io, int n) {
+    float drv = clampf(patch.drive.value(t), 0.f, 1.f);
+
+    filter.setFrequency(patch.cutoff.value(t));
+    filter.setResonance(clampf(patch.resonance.value(t), 0.f, 1.5f));
+    filter.setDrive(drv * drv);
+
+    /* automated cutoff is tracked at audio rate, by the classic core at its control rate if one is set */
+    bool controlled = patch.filter == PATCH_FILTER_CLASSIC && patch.controlRate > 0;
+    bool modulated = !patch.cutoff.isConstant() && !controlled;
+    if (modulated) patch.cutoff.fill(t, 1.f / patch.sampleRate, cutoff, n);
+
+    for (int i = 0; i < n; i++) {
+        io[i] = clampf(io[i] / 50, -0.6f, 0.6f);
+    }
+
+    filter.process(io, modulated ? cutoff : nullptr, lp, hp, bp, n);
+
+    const float *y = patch.output == PATCH_OUTPUT_HP ? hp : (patch.output == PATCH_OUTPUT_BP ? bp : lp);
+
+    for (int i = 0; i < n; i++) {
+        io[i] = y[i] * 50;
+    }
+}
+
+
+/**
+ * @brief Run a block through the ReShaper, as in ReShaper::step()
+ * @param t
+ * @param io Rack voltage
+ * @param n
+ */
+void RenderChain::processShaper(float t, float *io, int n) {
+    float a = clampf(patch.amount.value(t), 1.f, 50.f);
+
+    if (shaper.curve.a != a) {
+        shaper.curve.setAmount(a);
+        shaper.update();
+    }
+
+    for (int i = 0; i < n; i++) {
+        float x = clampf(io[i] * 0.1f, -1.f, 1.f);
+        float y;
+
+        if (patch.shaper == PATCH_SHAPER_ADAA) {
+            y = shaper.process(x);
+        } else if (patch.shaper > 1) {
+            os.doUpsample(x);
+
+            for (int k = 0; k < patch.shaper; k++) {
+                os.data[k][0] = shaper.curve.value(os.up[k]);
+            }
+
+            os.doDownsample();
+            y = os.getDownsampled(0);
+        } else {
+            y = shaper.curve.value(x);
+        }
+
+        io[i] = y * 5.f;
+    }
+}
+
+
+/**
+ * @brief Render a patch to a WAV file, the file is written while rendering
+ * @param patch
+ * @param path Output file
+ * @return
+ */
+RenderResult renderPatch(const Patch &patch, const std::string &path) {
+    auto t0 = std::chrono::steady_clock::now();
+    RenderResult result;
+
+    /* the filters and the oversampler hold large buffers, keep them off the worker stack */
+    std::unique_ptr<RenderChain> chain(new RenderChain(patch));
+    WavWriter wav;
+
+    /* a missing wavetable is reported by the cache */
+    if (!chain->init()) return result;
+
+    if (!wav.open(path, patch.sampleRate, patch.format)) return result;
+
+    long frames = lrint((double) patch.length * patch.sampleRate);
+    std::vector<float> buffer(RENDER_WRITE_BLOCK);
+    bool ok = true;
+
+    for (long pos = 0; pos < frames && ok;) {
+        int count = (int) std::min<long>(RENDER_WRITE_BLOCK, frames - pos);
+
+        for (int i = 0; i < count; i += RENDER_BLOCKSIZE) {
+            int n = std::min(RENDER_BLOCKSIZE, count - i);
+            chain->process((float) ((double) (pos + i) / patch.sampleRate), &buffer[i], n);
+        }
+
+        ok = wav.write(buffer.data(), count);
+        pos += count;
+    }
+
+    ok = wav.close() && ok;
+
+    result.ok = ok;
+    result.frames = wav.getFrames();
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    return result;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <string>
+#include "Patch.hpp"
+
+#define RENDER_BLOCKSIZE 16      // samples between control updates, as in the VCF and ReShaper modules
+#define RENDER_WRITE_BLOCK 4096  // samples written to disk at once
+
+
+/**
+ * @brief Outcome of one render
+ */
+struct RenderResult {
+    bool ok = false;
+    long frames = 0;      // samples written
+    double seconds = 0.;  // wall clock time of the render
+};
+
+
+RenderResult renderPatch(const Patch &patch, const std::string &path);
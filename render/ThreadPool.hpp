@@ -0,0 +1,113 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+/**
+ * @brief Fixed number of worker threads running queued jobs in submission order
+ *
+ * Jobs are independent and must not throw, wait() blocks until the queue is empty and all workers are idle.
+ */
+struct ThreadPool {
+    /**
+     * @brief Start the workers
+     * @param threads Number of workers, 0 uses one per hardware thread
+     */
+    explicit ThreadPool(int threads) {
+        if (threads < 1) threads = (int) std::thread::hardware_concurrency();
+        if (threads < 1) threads = 1;
+
+        for (int i = 0; i < threads; i++) {
+            workers.emplace_back([this]() { run(); });
+        }
+    }
+
+
+    /**
+     * @brief Finish all queued jobs and stop the workers
+     */
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+
+        queued.notify_all();
+
+        for (std::thread &t : workers) t.join();
+    }
+
+
+    /**
+     * @brief Queue a job, it is started as soon as a worker is free
+     * @param job
+     */
+    void submit(std::function<void()> job) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs.push_back(std::move(job));
+        }
+
+        queued.notify_one();
+    }
+
+
+    /**
+     * @brief Wait until all submitted jobs are finished
+     */
+    void wait() {
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [this]() { return jobs.empty() && active == 0; });
+    }
+
+
+    /**
+     * @brief Number of worker threads
+     * @return
+     */
+    int size() const {
+        return (int) workers.size();
+    }
+
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> jobs;
+    std::mutex mutex;
+    std::condition_variable queued, finished;
+    int active = 0;
+    bool stopping = false;
+
+
+    /**
+     * @brief Worker loop, takes jobs until the pool is stopped and the queue is empty
+     */
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex);
+
+        for (;;) {
+            queued.wait(lock, [this]() { return stopping || !jobs.empty(); });
+
+            if (jobs.empty()) return;
+
+            std::function<void()> job = std::move(jobs.front());
+            jobs.pop_front();
+            active++;
+
+            lock.unlock();
+            job();
+            lock.lock();
+
+            active--;
+            if (jobs.empty() && active == 0) finished.notify_all();
+        }
+    }
+
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+};
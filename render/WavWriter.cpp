@@ -0,0 +1,206 @@
+#include <cmath>
+#include <cstring>
+#include "DSPHost.hpp"
+#include "WavWriter.hpp"
+
+#define WAV_HEADER_SIZE 44
+
+
+/**
+ * @brief Store a 16 bit value little endian
+ * @param p
+ * @param v
+ */
+static void writeLE16(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t) v;
+    p[1] = (uint8_t) (v >> 8);
+}
+
+
+/**
+ * @brief Store a 32 bit value little endian
+ * @param p
+ * @param v
+ */
+static void writeLE32(uint8_t *p, uint32_t v) {
+    writeLE16(p, v);
+    writeLE16(p + 2, v >> 16);
+}
+
+
+/**
+ * @brief Bytes per sample of a format
+ * @param format WAV_FORMAT_16, WAV_FORMAT_24 or WAV_FORMAT_FLOAT
+ * @return
+ */
+static int bytesPerSample(int format) {
+    return format / 8;
+}
+
+
+/**
+ * @brief Build the RIFF header of a mono file
+ * @param header WAV_HEADER_SIZE bytes
+ * @param sampleRate
+ * @param format
+ * @param bytes Size of the sample data, an odd size is followed by a pad byte
+ */
+static void buildHeader(uint8_t *header, int sampleRate, int format, uint32_t bytes) {
+    int width = bytesPerSample(format);
+
+    memcpy(header, "RIFF", 4);
+    writeLE32(header + 4, WAV_HEADER_SIZE - 8 + bytes + (bytes & 1));
+    memcpy(header + 8, "WAVE", 4);
+
+    memcpy(header + 12, "fmt ", 4);
+    writeLE32(header + 16, 16);
+    writeLE16(header + 20, format == WAV_FORMAT_FLOAT ? 3 : 1);
+    writeLE16(header + 22, 1);
+    writeLE32(header + 24, (uint32_t) sampleRate);
+    writeLE32(header + 28, (uint32_t) (sampleRate * width));
+    writeLE16(header + 32, (uint32_t) width);
+    writeLE16(header + 34, (uint32_t) format);
+
+    memcpy(header + 36, "data", 4);
+    writeLE32(header + 40, bytes);
+}
+
+
+/**
+ * @brief Close the file if it is still open
+ */
+WavWriter::~WavWriter() {
+    close();
+}
+
+
+/**
+ * @brief Create the file and write the header, the sizes are filled in by close()
+ * @param path
+ * @param sampleRate
+ * @param format WAV_FORMAT_16, WAV_FORMAT_24 or WAV_FORMAT_FLOAT
+ * @return false if the file can not be created
+ */
+bool WavWriter::open(const std::string &path, int sampleRate, int format) {
+    close();
+
+    if (format != WAV_FORMAT_16 && format != WAV_FORMAT_24 && format != WAV_FORMAT_FLOAT) {
+        rack::warn("Unsupported WAV format %d for %s", format, path.c_str());
+        return false;
+    }
+
+    file = fopen(path.c_str(), "wb");
+
+    if (!file) {
+        rack::warn("Unable to create %s", path.c_str());
+        return false;
+    }
+
+    WavWriter::path = path;
+    WavWriter::format = format;
+    frames = 0;
+    failed = false;
+
+    uint8_t header[WAV_HEADER_SIZE];
+    buildHeader(header, sampleRate, format, 0);
+
+    if (fwrite(header, 1, WAV_HEADER_SIZE, file) != WAV_HEADER_SIZE) failed = true;
+
+    return !failed;
+}
+
+
+/**
+ * @brief Append a block of samples
+ * @param x
+ * @param n
+ * @return false on write errors or if the file exceeds the 4 GB limit of RIFF
+ */
+bool WavWriter::write(const float *x, int n) {
+    if (!file || failed) return false;
+
+    int width = bytesPerSample(format);
+
+    if ((frames + n) * width > 0xFFFFFFFFL - WAV_HEADER_SIZE - 1) {
+        rack::warn("%s exceeds the size limit of WAV files", path.c_str());
+        failed = true;
+        return false;
+    }
+
+    buffer.resize((size_t) n * width);
+    uint8_t *p = buffer.data();
+
+    for (int i = 0; i < n; i++, p += width) {
+        float v = x[i];
+
+        if (format == WAV_FORMAT_FLOAT) {
+            uint32_t u;
+
+            memcpy(&u, &v, sizeof(u));
+            writeLE32(p, u);
+            continue;
+        }
+
+        /* plain compares, NaN ends up as 0 */
+        v = v > 1.f ? 1.f : (v < -1.f ? -1.f : (v == v ? v : 0.f));
+
+        if (format == WAV_FORMAT_16) {
+            writeLE16(p, (uint32_t) (int32_t) lrintf(v * 32767.f));
+        } else {
+            uint32_t s = (uint32_t) (int32_t) lrintf(v * 8388607.f);
+
+            writeLE16(p, s);
+            p[2] = (uint8_t) (s >> 16);
+        }
+    }
+
+    if (fwrite(buffer.data(), 1, buffer.size(), file) != buffer.size()) {
+        rack::warn("Unable to write %s", path.c_str());
+        failed = true;
+        return false;
+    }
+
+    frames += n;
+
+    return true;
+}
+
+
+/**
+ * @brief Complete the header and close the file, does nothing if no file is open
+ * @return false if any write failed
+ */
+bool WavWriter::close() {
+    if (!file) return true;
+
+    uint32_t bytes = (uint32_t) (frames * bytesPerSample(format));
+    uint8_t header[WAV_HEADER_SIZE];
+
+    /* the sample rate is not kept, patch only the two sizes */
+    buildHeader(header, 0, format, bytes);
+
+    /* chunks have an even size */
+    if (!failed && (bytes & 1) && fputc(0, file) == EOF) failed = true;
+
+    if (!failed) {
+        if (fseek(file, 4, SEEK_SET) != 0 || fwrite(header + 4, 1, 4, file) != 4 ||
+            fseek(file, 40, SEEK_SET) != 0 || fwrite(header + 40, 1, 4, file) != 4) {
+            rack::warn("Unable to write %s", path.c_str());
+            failed = true;
+        }
+    }
+
+    if (fclose(file) != 0) failed = true;
+    file = nullptr;
+
+    return !failed;
+}
+
+
+/**
+ * @brief Frames written so far
+ * @return
+ */
+long WavWriter::getFrames() const {
+    return frames;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#define WAV_FORMAT_16 16     // 16 bit PCM
+#define WAV_FORMAT_24 24     // 24 bit PCM
+#define WAV_FORMAT_FLOAT 32  // 32 bit IEEE float
+
+
+/**
+ * @brief Mono WAV file written in blocks while rendering
+ *
+ * The header is written with empty sizes on open() and completed by close(), so only one block of
+ * samples is held in memory at any time. PCM formats are clipped to -1..1, float is written as is.
+ */
+struct WavWriter {
+    WavWriter() {}
+    ~WavWriter();
+
+    bool open(const std::string &path, int sampleRate, int format);
+    bool write(const float *x, int n);
+    bool close();
+
+    long getFrames() const;
+
+private:
+    FILE *file = nullptr;
+    std::string path;
+    int format = WAV_FORMAT_24;
+    long frames = 0;
+    bool failed = false;
+
+    /* converted samples of the current block */
+    std::vector<uint8_t> buffer;
+
+    WavWriter(const WavWriter &) = delete;
+    WavWriter &operator=(const WavWriter &) = delete;
+};
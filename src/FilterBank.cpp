@@ -0,0 +1,124 @@
+#include "dsp/LadderFilterBank.hpp"
+#include "LindenbergResearch.hpp"
+
+#define FILTERBANK_VOICES 8
+
+
+struct FilterBank : LRTModule {
+
+    enum ParamIds {
+        CUTOFF_PARAM,
+        RESONANCE_PARAM,
+        DRIVE_PARAM,
+        NUM_PARAMS
+    };
+
+    enum InputIds {
+        FILTER_INPUT,
+        NUM_INPUTS = FILTER_INPUT + FILTERBANK_VOICES
+    };
+
+    enum OutputIds {
+        LP_OUTPUT,
+        HP_OUTPUT = LP_OUTPUT + FILTERBANK_VOICES,
+        BP_OUTPUT = HP_OUTPUT + FILTERBANK_VOICES,
+        NUM_OUTPUTS = BP_OUTPUT + FILTERBANK_VOICES
+    };
+
+    enum LightIds {
+        NUM_LIGHTS
+    };
+
+    LadderFilterBank<FILTERBANK_VOICES> filter;
+
+    FilterBank() : LRTModule(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS) {}
+
+
+    void process() override;
+    void onSampleRateChange() override;
+};
+
+
+/**
+ * @brief Pass the new sample rate to all filter voices
+ */
+void FilterBank::onSampleRateChange() {
+    LRTModule::onSampleRateChange();
+
+    filter.setSampleRate(sampleRate);
+}
+
+
+void FilterBank::process() {
+    float frequency = params[CUTOFF_PARAM].value;
+    float resonance = params[RESONANCE_PARAM].value;
+    float drive = params[DRIVE_PARAM].value * params[DRIVE_PARAM].value;
+
+    for (int i = 0; i < FILTERBANK_VOICES; i++) {
+        filter.setFrequency(i, frequency);
+        filter.setResonance(i, resonance);
+        filter.setDrive(i, drive);
+
+        filter.setIn(i, clampf(inputs[FILTER_INPUT + i].value / 50, -0.6, 0.6));
+    }
+
+    filter.process();
+
+    for (int i = 0; i < FILTERBANK_VOICES; i++) {
+        outputs[LP_OUTPUT + i].value = filter.getLpOut(i) * 50;
+        outputs[HP_OUTPUT + i].value = filter.getHpOut(i) * 50;
+        outputs[BP_OUTPUT + i].value = filter.getBpOut(i) * 50;
+    }
+}
+
+
+FilterBankWidget::FilterBankWidget() {
+    FilterBank *module = new FilterBank();
+
+    setModule(module);
+    box.size = Vec(FILTERBANK_WIDTH * RACK_GRID_WIDTH, RACK_GRID_HEIGHT);
+
+    {
+        SVGPanel *panel = new SVGPanel();
+        panel->box.size = box.size;
+        panel->setBackground(SVG::load(assetPlugin(plugin, "res/FilterBank.svg")));
+        addChild(panel);
+    }
+
+    // ***** SCREWS **********
+    addChild(createScrew<ScrewDarkA>(Vec(15, 2)));
+    addChild(createScrew<ScrewDarkA>(Vec(box.size.x - 30, 2)));
+    addChild(createScrew<ScrewDarkA>(Vec(15, 365)));
+    addChild(createScrew<ScrewDarkA>(Vec(box.size.x - 30, 365)));
+    // ***** SCREWS **********
+
+    // ***** MAIN KNOBS ******
+    addParam(createParam<LRBigKnob>(Vec(187.5, 70), module, FilterBank::CUTOFF_PARAM, 0.f, 1.f, 0.f));
+    addParam(createParam<LRMiddleKnob>(Vec(195, 155), module, FilterBank::RESONANCE_PARAM, -0.f, 1.5, 0.0f));
+    addParam(createParam<LRMiddleKnob>(Vec(195, 230), module, FilterBank::DRIVE_PARAM, 0.0f, 1.f, 0.0f));
+    // ***** MAIN KNOBS ******
+
+    // ***** INPUTS / OUTPUTS
+    for (int i = 0; i < FILTERBANK_VOICES; i++) {
+        float y = 62 + i * 34;
+
+        addInput(createInput<IOPort>(Vec(15, y), module, FilterBank::FILTER_INPUT + i));
+        addOutput(createOutput<IOPort>(Vec(55, y), module, FilterBank::HP_OUTPUT + i));
+        addOutput(createOutput<IOPort>(Vec(95, y), module, FilterBank::BP_OUTPUT + i));
+        addOutput(createOutput<IOPort>(Vec(135, y), module, FilterBank::LP_OUTPUT + i));
+    }
+    // ***** INPUTS / OUTPUTS
+}
+
+
+/**
+ * @brief Add profiling to context menu
+ * @return
+ */
+Menu *FilterBankWidget::createContextMenu() {
+    Menu *menu = ModuleWidget::createContextMenu();
+
+    addProfilerMenu(menu, dynamic_cast<FilterBank *>(module));
+
+    return menu;
+}
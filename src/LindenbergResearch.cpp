@@ -1,3 +1,9 @@
+#include <algorithm>
+#include <cxxabi.h>
+#include <mutex>
+#include <set>
+#include <typeinfo>
+#include <cstdlib>
 #include "LindenbergResearch.hpp"
 
 using namespace rack;
@@ -19,6 +25,9 @@ void init(rack::Plugin *p) {
     p->addModel(createModel<BlankPanelWidgetM1>("Lindenberg Research", "BlankPanel Mark I", "Blank Panel 12TE", UTILITY_TAG));
     p->addModel(createModel<ReShaperWidget>("Lindenberg Research", "ReShaper", "ReShaper Wavefolder", FILTER_TAG));
     p->addModel(createModel<VCOWidget>("Lindenberg Research", "VCO", "Voltage Controlled Oscillator", OSCILLATOR_TAG));
+    p->addModel(createModel<FilterBankWidget>("Lindenberg Research", "FilterBank", "8-Voice Ladder Filter Bank", FILTER_TAG));
+    p->addModel(createModel<VCOBankWidget>("Lindenberg Research", "VCOBank", "16-Voice Polyphonic VCO", OSCILLATOR_TAG));
+    p->addModel(createModel<ReShaperBankWidget>("Lindenberg Research", "ReShaperBank", "8-Voice ReShaper Wavefolder", FILTER_TAG));
 }
 
 
@@ -49,14 +58,245 @@ void LCDWidget::draw(NVGcontext *vg) {
 }
 
 
+/* all LRT modules of the rack, for profiling them together */
+static std::mutex registryMutex;
+static std::set<LRTModule *> registry;
+static int nextId = 1;
+
+
+LRTModule::LRTModule(int numParams, int numInputs, int numOutputs, int numLights) :
+        Module(numParams, numInputs, numOutputs, numLights) {
+    sampleRate = engineGetSampleRate();
+    profiling = false;
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+    id = nextId++;
+    registry.insert(this);
+}
+
+
+LRTModule::~LRTModule() {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    registry.erase(this);
+}
+
+
 /**
- * @brief Custom step implementation for LRT Modules
+ * @brief Custom step implementation for LRT Modules, counts the steps and profiles process() on demand
  */
 void LRTModule::step() {
-    Module::step();
-
     // increment counter
     cnt++;
+
+    if (!profiling.load(std::memory_order_relaxed)) {
+        process();
+        return;
+    }
+
+    uint64_t start = StepProfiler::now();
+    process();
+    profiler.record(StepProfiler::now() - start);
+}
+
+
+/**
+ * @brief Take over the new engine sample rate, modules override this to pass it on to their DSP objects
+ */
+void LRTModule::onSampleRateChange() {
+    Module::onSampleRateChange();
+
+    sampleRate = engineGetSampleRate();
+}
+
+
+/**
+ * @brief Switch profiling of this instance on or off, every new run starts with an empty histogram
+ * @param enabled
+ */
+void LRTModule::setProfiling(bool enabled) {
+    if (enabled && !profiling) profiler.reset();
+
+    profiling = enabled;
+}
+
+
+/**
+ * @brief Class name and instance number for log lines
+ * @return
+ */
+std::string LRTModule::getName() {
+    int status;
+    char *name = abi::__cxa_demangle(typeid(*this).name(), nullptr, nullptr, &status);
+
+    std::string result = stringf("%s #%d", status == 0 ? name : typeid(*this).name(), id);
+    free(name);
+
+    return result;
+}
+
+
+/**
+ * @brief Percentiles of the step cost in microseconds and the share of the sample period taken by p99
+ * @return
+ */
+std::string LRTModule::getProfileText() {
+    StepProfile p = profiler.getProfile();
+
+    if (p.count == 0) return profiling ? "Profiling..." : "Not profiled";
+
+    double budget = 1e9 / sampleRate;
+
+    return stringf("p50 %.2f  p99 %.2f  max %.1f us  (p99 %.1f%% of a sample)", p.p50 * 1e-3, p.p99 * 1e-3,
+                   p.max * 1e-3, 100. * p.p99 / budget);
+}
+
+
+/**
+ * @brief Switch profiling of all LRT modules on or off
+ * @param enabled
+ */
+void LRTModule::setProfilingAll(bool enabled) {
+    std::lock_guard<std::mutex> lock(registryMutex);
+
+    for (LRTModule *m : registry) {
+        m->setProfiling(enabled);
+    }
+}
+
+
+/**
+ * @brief True if all LRT modules are profiled
+ * @return
+ */
+bool LRTModule::isProfilingAll() {
+    std::lock_guard<std::mutex> lock(registryMutex);
+
+    for (LRTModule *m : registry) {
+        if (!m->profiling) return false;
+    }
+
+    return !registry.empty();
+}
+
+
+/**
+ * @brief Write one line per profiled module to the log, the most expensive first
+ */
+void LRTModule::logProfiles() {
+    std::vector<std::pair<double, std::string>> lines;
+
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+
+        for (LRTModule *m : registry) {
+            StepProfile p = m->profiler.getProfile();
+            if (p.count == 0) continue;
+
+            lines.push_back(std::make_pair(p.p99, m->getName() + ": " + m->getProfileText()));
+        }
+    }
+
+    if (lines.empty()) {
+        info("LRT profiling: no module profiled");
+        return;
+    }
+
+    std::sort(lines.begin(), lines.end(), [](const std::pair<double, std::string> &a,
+                                              const std::pair<double, std::string> &b) {
+        return a.first > b.first;
+    });
+
+    for (const std::pair<double, std::string> &line : lines) {
+        info("LRT profiling: %s", line.second.c_str());
+    }
+}
+
+
+/**
+ * @brief Context menu entry for profiling of one module
+ */
+struct ProfilerItem : MenuItem {
+    LRTModule *module;
+
+
+    void onAction(EventAction &e) override {
+        module->setProfiling(!module->profiling);
+    }
+
+
+    void step() override {
+        rightText = module->profiling ? "✔" : "";
+        MenuItem::step();
+    }
+};
+
+
+/**
+ * @brief Context menu entry for profiling of all LRT modules
+ */
+struct ProfilerAllItem : MenuItem {
+    void onAction(EventAction &e) override {
+        LRTModule::setProfilingAll(!LRTModule::isProfilingAll());
+    }
+
+
+    void step() override {
+        rightText = LRTModule::isProfilingAll() ? "✔" : "";
+        MenuItem::step();
+    }
+};
+
+
+/**
+ * @brief Context menu entry to log the profiles of all LRT modules
+ */
+struct ProfilerLogItem : MenuItem {
+    void onAction(EventAction &e) override {
+        LRTModule::logProfiles();
+    }
+};
+
+
+/**
+ * @brief Context menu entry to start over with an empty histogram
+ */
+struct ProfilerResetItem : MenuItem {
+    LRTModule *module;
+
+
+    void onAction(EventAction &e) override {
+        module->profiler.reset();
+    }
+};
+
+
+/**
+ * @brief Live readout of the profile while the menu is open
+ */
+struct ProfilerLabel : MenuLabel {
+    LRTModule *module;
+
+
+    void step() override {
+        text = module->getProfileText();
+        MenuLabel::step();
+    }
+};
+
+
+/**
+ * @brief Add the profiling section to the context menu of a module
+ * @param menu
+ * @param module
+ */
+void addProfilerMenu(Menu *menu, LRTModule *module) {
+    menu->pushChild(construct<MenuLabel>());
+    menu->pushChild(construct<MenuLabel>(&MenuLabel::text, "Profiling"));
+    menu->pushChild(construct<ProfilerItem>(&MenuItem::text, "Profile this module", &ProfilerItem::module, module));
+    menu->pushChild(construct<ProfilerAllItem>(&MenuItem::text, "Profile all LRT modules"));
+    menu->pushChild(construct<ProfilerLabel>(&MenuLabel::text, module->getProfileText(), &ProfilerLabel::module, module));
+    menu->pushChild(construct<ProfilerResetItem>(&MenuItem::text, "Reset profile", &ProfilerResetItem::module, module));
+    menu->pushChild(construct<ProfilerLogItem>(&MenuItem::text, "Log all profiles"));
 }
 
 
@@ -3,6 +3,7 @@
 #include "rack.hpp"
 #include "asset.hpp"
 #include "widgets.hpp"
+#include "dsp/StepProfiler.hpp"
 
 using namespace rack;
 
@@ -14,8 +15,11 @@ using namespace rack;
 #define BLANKPANEL_WIDTH 18.f
 #define BLANKPANEL_MARK_I_WIDTH 12.f
 #define FILTER_WIDTH 12.f
-#define OSCILLATOR_WIDTH 11.f
+#define FILTERBANK_WIDTH 18.f
+#define OSCILLATOR_WIDTH 15.f
+#define VCOBANK_WIDTH 18.f
 #define RESHAPER_WIDTH 8.f
+#define RESHAPERBANK_WIDTH 14.f
 
 
 static const int width = 220;
@@ -24,6 +28,7 @@ extern Plugin *plugin;
 
 struct SimpleFilterWidget : ModuleWidget {
     SimpleFilterWidget();
+    Menu *createContextMenu() override;
 };
 
 
@@ -39,16 +44,47 @@ struct BlankPanelWidgetM1 : ModuleWidget {
 
 struct ReShaperWidget : ModuleWidget {
     ReShaperWidget();
+    Menu *createContextMenu() override;
 };
 
 
 struct VCOWidget : ModuleWidget {
     VCOWidget();
+    Menu *createContextMenu() override;
 };
 
 
+struct FilterBankWidget : ModuleWidget {
+    FilterBankWidget();
+    Menu *createContextMenu() override;
+};
+
+
+struct VCOBankWidget : ModuleWidget {
+    VCOBankWidget();
+    Menu *createContextMenu() override;
+};
+
+
+struct ReShaperBankWidget : ModuleWidget {
+    ReShaperBankWidget();
+    Menu *createContextMenu() override;
+};
+
+
+/**
+ * @brief Base of all LRT modules
+ *
+ * step() counts the steps and calls process() of the module. With profiling switched on, the cost of every
+ * process() goes into a StepProfiler, switched off it costs a single relaxed load per step.
+ */
 struct LRTModule : Module {
     long cnt = 0;
+    float sampleRate; // current engine sample rate, updated by onSampleRateChange()
+    int id;           // number of the instance in log lines
+
+    std::atomic<bool> profiling;
+    StepProfiler profiler;
 
 
     /**
@@ -58,14 +94,31 @@ struct LRTModule : Module {
      * @param numOutputs
      * @param numLights
      */
-    LRTModule(int numParams, int numInputs, int numOutputs, int numLights = 0) :
-            Module(numParams, numInputs, numOutputs, numLights) {}
+    LRTModule(int numParams, int numInputs, int numOutputs, int numLights = 0);
+    ~LRTModule();
 
 
     void step() override;
+    void onSampleRateChange() override;
+
+    /**
+     * @brief Process one sample, implemented by every module instead of step()
+     */
+    virtual void process() = 0;
+
+    void setProfiling(bool enabled);
+    std::string getName();
+    std::string getProfileText();
+
+    static void setProfilingAll(bool enabled);
+    static bool isProfilingAll();
+    static void logProfiles();
 };
 
 
+void addProfilerMenu(Menu *menu, LRTModule *module);
+
+
 /**
  * @brief Emulation of a LCD monochrome display
  */
@@ -1,6 +1,13 @@
+#include "dsp/Waveshaper.hpp"
+#include "dsp/Oversampler.hpp"
 #include "LindenbergResearch.hpp"
 
-struct ReShaper : Module {
+#define RESHAPER_QUALITY_ADAA 0  // antiderivative antialiasing at the base rate, otherwise the oversampling factor
+#define RESHAPER_CONTROL_RATE 16 // samples between updates of the target amount, the curve is ramped over them
+#define RESHAPER_MAX_FACTOR 8
+
+
+struct ReShaper : LRTModule {
     enum ParamIds {
         RESHAPER_AMOUNT,
         RESHAPER_CV_AMOUNT,
@@ -22,21 +29,126 @@ struct ReShaper : Module {
         NUM_LIGHTS
     };
 
-    ReShaper() : Module(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS) {}
+    /* oversampling factor 1..8 or RESHAPER_QUALITY_ADAA, selected by the user, applied from the audio thread */
+    int quality = 1;
+    int controlCnt = 0;
+    float amount = 1.f, da = 0.f; // target amount of the curve and ramp step per sample
+    bool adaaStale = false;       // antiderivative terms of the curve skipped while ramping without ADAA
 
-    void step() override;
+    /* the curve of the ADAA stage is shared by all quality modes */
+    ADAA<ReShaperCurve> adaa;
+    Oversampler<1> os;
+
+    ReShaper() : LRTModule(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS) {
+        adaa.curve.setAmount(1.f);
+        adaa.update();
+    }
+
+    void updateAmount();
+    void rampAmount();
+    void process() override;
+    json_t *toJson() override;
+    void fromJson(json_t *rootJ) override;
 };
 
 
-void ReShaper::step() {
+/**
+ * @brief Save quality mode with patch
+ * @return
+ */
+json_t *ReShaper::toJson() {
+    json_t *rootJ = json_object();
+    json_object_set_new(rootJ, "quality", json_integer(quality));
+    return rootJ;
+}
+
+
+/**
+ * @brief Restore quality mode from patch
+ * @param rootJ
+ */
+void ReShaper::fromJson(json_t *rootJ) {
+    json_t *qualityJ = json_object_get(rootJ, "quality");
+
+    if (qualityJ) {
+        int q = (int) json_integer_value(qualityJ);
+        quality = (q == RESHAPER_QUALITY_ADAA || q == 2 || q == 4 || q == RESHAPER_MAX_FACTOR) ? q : 1;
+    }
+}
+
+
+/**
+ * @brief Compute the target amount from knob and CV and start a ramp towards it, called at control rate
+ */
+void ReShaper::updateAmount() {
+    float cv = inputs[RESHAPER_CV_INPUT].value * params[RESHAPER_CV_AMOUNT].value;
+
+    amount = clampf(params[RESHAPER_AMOUNT].value + cv, 1.f, 50.f);
+    da = (amount - adaa.curve.a) / RESHAPER_CONTROL_RATE;
+}
+
+
+/**
+ * @brief Move the curve coefficients one sample along the ramp, nothing to do once the target is reached
+ *
+ * Only the ADAA mode needs the antiderivative terms and its state updated, the other modes only ramp the
+ * coefficients of value().
+ */
+void ReShaper::rampAmount() {
+    if (adaa.curve.a == amount) return;
+
+    /* the last sample of a ramp hits the target exactly */
+    float a = controlCnt > 0 ? adaa.curve.a + da : amount;
+
+    if (quality == RESHAPER_QUALITY_ADAA) {
+        adaa.curve.setAmount(a);
+
+        /* keeps the ADAA stage continuous across the change */
+        adaa.update();
+    } else {
+        adaa.curve.setValueAmount(a);
+        adaaStale = true;
+    }
+}
+
+
+void ReShaper::process() {
+    if (--controlCnt < 0) {
+        controlCnt = RESHAPER_CONTROL_RATE - 1;
+        updateAmount();
+    }
+
+    rampAmount();
+
     // normalize signal input to [-1.0...+1.0]
     float x = clampf(inputs[RESHAPER_INPUT].value * 0.1f, -1.f, 1.f);
-    float cv = inputs[RESHAPER_CV_INPUT].value * params[RESHAPER_CV_AMOUNT].value;
-    float a = clampf(params[RESHAPER_AMOUNT].value + cv, 1.f, 50.f);
+    float out;
 
     // do the acid!
-    float out = x * (abs(x) + a) / (x * x + (a - 1) * abs(x) + 1);
-  
+    if (quality == RESHAPER_QUALITY_ADAA) {
+        /* catch up with a ramp of another mode */
+        if (adaaStale) {
+            adaa.curve.setAmount(adaa.curve.a);
+            adaa.update();
+            adaaStale = false;
+        }
+
+        out = adaa.process(x);
+    } else if (quality > 1) {
+        if (os.factor != quality) os.setFactor(quality);
+
+        os.doUpsample(x);
+
+        for (int i = 0; i < quality; i++) {
+            os.data[i][0] = adaa.curve.value(os.up[i]);
+        }
+
+        os.doDownsample();
+        out = os.getDownsampled(0);
+    } else {
+        out = adaa.curve.value(x);
+    }
+
     outputs[RESHAPER_OUTPUT].value = out * 5.0f;
 }
 
@@ -77,3 +189,52 @@ ReShaperWidget::ReShaperWidget() {
     addOutput(createOutput<IOPort>(Vec(46, 320), module, ReShaper::RESHAPER_OUTPUT));
     // ***** OUTPUTS *********
 }
+
+
+/**
+ * @brief Context menu entry for the quality mode
+ */
+struct ReShaperQualityItem : MenuItem {
+    ReShaper *reShaper;
+    int quality;
+
+
+    void onAction(EventAction &e) override {
+        reShaper->quality = quality;
+    }
+
+
+    void step() override {
+        rightText = (reShaper->quality == quality) ? "✔" : "";
+        MenuItem::step();
+    }
+};
+
+
+/**
+ * @brief Add quality selection to context menu
+ * @return
+ */
+Menu *ReShaperWidget::createContextMenu() {
+    Menu *menu = ModuleWidget::createContextMenu();
+    ReShaper *reShaper = dynamic_cast<ReShaper *>(module);
+
+    menu->pushChild(construct<MenuLabel>());
+    menu->pushChild(construct<MenuLabel>(&MenuLabel::text, "Quality"));
+
+    for (int factor = 1; factor <= RESHAPER_MAX_FACTOR; factor *= 2) {
+        menu->pushChild(construct<ReShaperQualityItem>(&MenuItem::text,
+                                                       factor == 1 ? std::string("1x (no antialiasing)") :
+                                                       stringf("%dx oversampling", factor),
+                                                       &ReShaperQualityItem::reShaper, reShaper,
+                                                       &ReShaperQualityItem::quality, factor));
+    }
+
+    menu->pushChild(construct<ReShaperQualityItem>(&MenuItem::text, "Antiderivative (ADAA)",
+                                                   &ReShaperQualityItem::reShaper, reShaper,
+                                                   &ReShaperQualityItem::quality, RESHAPER_QUALITY_ADAA));
+
+    addProfilerMenu(menu, reShaper);
+
+    return menu;
+}
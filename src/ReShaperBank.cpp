@@ -0,0 +1,168 @@
+#include "dsp/ReShaperCurveBank.hpp"
+#include "LindenbergResearch.hpp"
+
+#define RESHAPERBANK_VOICES 8
+#define RESHAPERBANK_CONTROL_RATE 16 // samples between updates of the amounts, the curves are ramped over them
+
+
+struct ReShaperBank : LRTModule {
+
+    enum ParamIds {
+        AMOUNT_PARAM,
+        CV_AMOUNT_PARAM,
+        NUM_PARAMS
+    };
+
+    enum InputIds {
+        SIGNAL_INPUT,
+        CV_INPUT = SIGNAL_INPUT + RESHAPERBANK_VOICES,
+        NUM_INPUTS = CV_INPUT + RESHAPERBANK_VOICES
+    };
+
+    enum OutputIds {
+        SIGNAL_OUTPUT,
+        NUM_OUTPUTS = SIGNAL_OUTPUT + RESHAPERBANK_VOICES
+    };
+
+    enum LightIds {
+        NUM_LIGHTS
+    };
+
+    ReShaperCurveBank<RESHAPERBANK_VOICES> shaper;
+    int controlCnt = 0;
+
+    ReShaperBank() : LRTModule(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS) {
+        /* same reaction to CV as the single ReShaper */
+        shaper.setRamp(RESHAPERBANK_CONTROL_RATE);
+    }
+
+
+    void process() override;
+    json_t *toJson() override;
+    void fromJson(json_t *rootJ) override;
+};
+
+
+/**
+ * @brief Save ADAA mode with patch
+ * @return
+ */
+json_t *ReShaperBank::toJson() {
+    json_t *rootJ = json_object();
+    json_object_set_new(rootJ, "adaa", json_boolean(shaper.getADAA()));
+    return rootJ;
+}
+
+
+/**
+ * @brief Restore ADAA mode from patch
+ * @param rootJ
+ */
+void ReShaperBank::fromJson(json_t *rootJ) {
+    json_t *adaaJ = json_object_get(rootJ, "adaa");
+
+    if (adaaJ) {
+        shaper.setADAA(json_is_true(adaaJ));
+    }
+}
+
+
+void ReShaperBank::process() {
+    // amounts follow knob and CV at control rate
+    if (--controlCnt < 0) {
+        controlCnt = RESHAPERBANK_CONTROL_RATE - 1;
+
+        float amount = params[AMOUNT_PARAM].value;
+        float cvAmount = params[CV_AMOUNT_PARAM].value;
+
+        for (int i = 0; i < RESHAPERBANK_VOICES; i++) {
+            shaper.setAmount(i, clampf(amount + inputs[CV_INPUT + i].value * cvAmount, 1.f, 50.f));
+        }
+    }
+
+    // normalize signal inputs to [-1.0...+1.0]
+    for (int i = 0; i < RESHAPERBANK_VOICES; i++) {
+        shaper.setIn(i, clampf(inputs[SIGNAL_INPUT + i].value * 0.1f, -1.f, 1.f));
+    }
+
+    shaper.process();
+
+    for (int i = 0; i < RESHAPERBANK_VOICES; i++) {
+        outputs[SIGNAL_OUTPUT + i].value = shaper.getOut(i) * 5.0f;
+    }
+}
+
+
+ReShaperBankWidget::ReShaperBankWidget() {
+    ReShaperBank *module = new ReShaperBank();
+
+    setModule(module);
+    box.size = Vec(RESHAPERBANK_WIDTH * RACK_GRID_WIDTH, RACK_GRID_HEIGHT);
+
+    {
+        SVGPanel *panel = new SVGPanel();
+        panel->box.size = box.size;
+        panel->setBackground(SVG::load(assetPlugin(plugin, "res/ReShaperBank.svg")));
+        addChild(panel);
+    }
+
+    // ***** SCREWS **********
+    addChild(createScrew<ScrewDarkA>(Vec(15, 2)));
+    addChild(createScrew<ScrewDarkA>(Vec(box.size.x - 30, 2)));
+    addChild(createScrew<ScrewDarkA>(Vec(15, 365)));
+    addChild(createScrew<ScrewDarkA>(Vec(box.size.x - 30, 365)));
+    // ***** SCREWS **********
+
+    // ***** MAIN KNOBS ******
+    addParam(createParam<LRBigKnob>(Vec(140, 70), module, ReShaperBank::AMOUNT_PARAM, 1.f, 50.f, 1.f));
+    addParam(createParam<LRSmallKnob>(Vec(155.5, 160), module, ReShaperBank::CV_AMOUNT_PARAM, 0.f, 5.f, 0.f));
+    // ***** MAIN KNOBS ******
+
+    // ***** INPUTS / OUTPUTS
+    for (int i = 0; i < RESHAPERBANK_VOICES; i++) {
+        float y = 62 + i * 34;
+
+        addInput(createInput<IOPort>(Vec(15, y), module, ReShaperBank::SIGNAL_INPUT + i));
+        addInput(createInput<IOPort>(Vec(55, y), module, ReShaperBank::CV_INPUT + i));
+        addOutput(createOutput<IOPort>(Vec(95, y), module, ReShaperBank::SIGNAL_OUTPUT + i));
+    }
+    // ***** INPUTS / OUTPUTS
+}
+
+
+/**
+ * @brief Context menu entry toggling ADAA
+ */
+struct ReShaperBankADAAItem : MenuItem {
+    ReShaperBank *reShaper;
+
+
+    void onAction(EventAction &e) override {
+        reShaper->shaper.setADAA(!reShaper->shaper.getADAA());
+    }
+
+
+    void step() override {
+        rightText = reShaper->shaper.getADAA() ? "✔" : "";
+        MenuItem::step();
+    }
+};
+
+
+/**
+ * @brief Add ADAA toggle to context menu
+ * @return
+ */
+Menu *ReShaperBankWidget::createContextMenu() {
+    Menu *menu = ModuleWidget::createContextMenu();
+    ReShaperBank *reShaper = dynamic_cast<ReShaperBank *>(module);
+
+    menu->pushChild(construct<MenuLabel>());
+    menu->pushChild(construct<MenuLabel>(&MenuLabel::text, "Quality"));
+    menu->pushChild(construct<ReShaperBankADAAItem>(&MenuItem::text, "Antiderivative (ADAA)",
+                                                    &ReShaperBankADAAItem::reShaper, reShaper));
+
+    addProfilerMenu(menu, reShaper);
+
+    return menu;
+}
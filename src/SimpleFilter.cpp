@@ -1,7 +1,13 @@
 #include "dsp/LadderFilter.hpp"
+#include "dsp/ZDFLadderFilter.hpp"
 #include "dsp/DSPMath.hpp"
 #include "LindenbergResearch.hpp"
 
+#define FILTER_BLOCKSIZE 16
+
+#define FILTER_CORE_CLASSIC 0
+#define FILTER_CORE_ZDF 1
+
 
 struct SimpleFilter : LRTModule {
 
@@ -38,92 +44,130 @@ struct SimpleFilter : LRTModule {
     LCDWidget *label2 = new LCDWidget(LCD_COLOR_FG, 12);
 
     LadderFilter filter;
+    ZDFLadderFilter zdfFilter;
 
-    SimpleFilter() : LRTModule(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS) {}
-
-
-    void step() override;
-};
+    /* filter core and oversampling factor per core selected by the user, applied from the audio thread */
+    int core = FILTER_CORE_CLASSIC;
+    int oversampling[2] = {8, ZDF_OVERSAMPLE};
 
+    /* the filter runs on blocks, outputs are delayed by one block */
+    float inBuffer[FILTER_BLOCKSIZE] = {};
+    float cutoffBuffer[FILTER_BLOCKSIZE] = {};
+    float lpBuffer[FILTER_BLOCKSIZE] = {};
+    float hpBuffer[FILTER_BLOCKSIZE] = {};
+    float bpBuffer[FILTER_BLOCKSIZE] = {};
+    int bufferPos = 0;
 
-void SimpleFilter::step() {
-    cnt++;
-    filter.setFrequency(params[CUTOFF_PARAM].value);
-    filter.setResonance(params[RESONANCE_PARAM].value);
-    filter.setDrive(params[DRIVE_PARAM].value * params[DRIVE_PARAM].value);
+    SimpleFilter() : LRTModule(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS) {}
 
-    float y = clampf(inputs[FILTER_INPUT].value / 50, -0.6, 0.6);
 
-    filter.setIn(y);
+    template<typename FILTER>
+    void processBlock(FILTER &ladder, int factor, bool modulated);
 
-    filter.process();
+    void process() override;
+    void onSampleRateChange() override;
+    json_t *toJson() override;
+    void fromJson(json_t *rootJ) override;
+};
 
-    outputs[LP_OUTPUT].value = filter.getLpOut() * 50;
-    outputs[HP_OUTPUT].value = filter.getHpOut() * 50;
-    outputs[BP_OUTPUT].value = filter.getBpOut() * 50;
 
+/**
+ * @brief Pass the new sample rate to both filter cores
+ */
+void SimpleFilter::onSampleRateChange() {
+    LRTModule::onSampleRateChange();
 
-    /*  double cut_cv = inputs[CUTOFF_CV_INPUT].value * 0.05;
-      double res_cv = inputs[RESONANCE_CV_INPUT].value * 0.05;
+    filter.setSampleRate(sampleRate);
+    zdfFilter.setSampleRate(sampleRate);
+}
 
-      // compute CV inputs
-      double cutoff = (cut_cv * quadraticBipolar(params[CUTOFF_CV_PARAM].value));
-      double res = (res_cv * quadraticBipolar(params[RESONANCE_CV_PARAM].value));
 
+/**
+ * @brief Save filter core and oversampling factors with patch
+ * @return
+ */
+json_t *SimpleFilter::toJson() {
+    json_t *rootJ = json_object();
+    json_object_set_new(rootJ, "core", json_integer(core));
+    json_object_set_new(rootJ, "oversampling", json_integer(oversampling[FILTER_CORE_CLASSIC]));
+    json_object_set_new(rootJ, "zdfOversampling", json_integer(oversampling[FILTER_CORE_ZDF]));
+    return rootJ;
+}
 
-      // translate frequency to logarithmic scale
-      freqHz = 20. * pow(1000., params[CUTOFF_PARAM].value + cutoff);
-      frequency = clampd(freqHz * (1. / (engineGetSampleRate() / 2.0)), 0., 1.);
 
-      resonance = clampd(params[RESONANCE_PARAM].value + res, 0, 1.1);
-      // add some curve to resonance to avoid aliasing at high frequency
-      resonance *= (-0.3 * frequency + 1);
+/**
+ * @brief Restore filter core and oversampling factors from patch
+ * @param rootJ
+ */
+void SimpleFilter::fromJson(json_t *rootJ) {
+    json_t *coreJ = json_object_get(rootJ, "core");
+    json_t *oversamplingJ = json_object_get(rootJ, "oversampling");
+    json_t *zdfOversamplingJ = json_object_get(rootJ, "zdfOversampling");
 
-      // stringf("%f", freqHz);
-      //  label2->text = stringf("%-.6f", resonance);
+    if (coreJ) {
+        core = (int) json_integer_value(coreJ) == FILTER_CORE_ZDF ? FILTER_CORE_ZDF : FILTER_CORE_CLASSIC;
+    }
 
-      // normalize signal input to [-1.0...+1.0]
-      // filter starts to be very unstable for input gain above 1.f and below 0.f
-      //in = clampd(inputs[FILTER_INPUT].value / 15., -0.7, 0.7);
+    if (oversamplingJ) {
+        int f = (int) json_integer_value(oversamplingJ);
+        oversampling[FILTER_CORE_CLASSIC] = (f == 2 || f == 4 || f == 8 || f == 16) ? f : 8;
+    }
 
-      in = clip(inputs[FILTER_INPUT].value / 10, 0.8, -0.8);
+    if (zdfOversamplingJ) {
+        int f = (int) json_integer_value(zdfOversamplingJ);
+        oversampling[FILTER_CORE_ZDF] = (f == 2 || f == 4 || f == 8 || f == 16) ? f : ZDF_OVERSAMPLE;
+    }
+}
 
-      // Set coefficients given frequency & resonance [0.0...1.0]
-      q = 1.0 - frequency;
-      p = frequency + 0.8 * frequency * q;
-      f = p + p - 1.0;
-      q = resonance * (1.0 + 0.5 * q * (1.0 - q + 5.6 * q * q));
 
+/**
+ * @brief Apply parameters and run one block through the given filter core
+ * @param ladder
+ * @param factor
+ * @param modulated Use the cutoff of every sample instead of the knob
+ */
+template<typename FILTER>
+void SimpleFilter::processBlock(FILTER &ladder, int factor, bool modulated) {
+    if (ladder.getOversampling() != factor) {
+        ladder.setOversampling(factor);
+    }
 
-      in -= q * b4;
+    // resonance and drive CV is sampled once per block, the filter ramps the coefficients in between
+    float res = params[RESONANCE_PARAM].value + inputs[RESONANCE_CV_INPUT].value * 0.15f * params[RESONANCE_CV_PARAM].value;
+    float drv = clampf(params[DRIVE_PARAM].value + inputs[DRIVE_CV_INPUT].value * 0.1f * params[DRIVE_CV_PARAM].value, 0.f, 1.f);
 
-      t1 = b1;
-      b1 = (in + b0) * p - b1 * f;
+    ladder.setFrequency(params[CUTOFF_PARAM].value);
+    ladder.setResonance(clampf(res, 0.f, 1.5f));
+    ladder.setDrive(drv * drv);
 
-      t2 = b2;
-      b2 = (b1 + t1) * p - b2 * f;
+    ladder.process(inBuffer, modulated ? cutoffBuffer : nullptr, lpBuffer, hpBuffer, bpBuffer, FILTER_BLOCKSIZE);
+}
 
-      t1 = b3;
-      b3 = (b2 + t2) * p - b3 * f;
 
-      b4 = (b3 + t1) * p - b4 * f;
+void SimpleFilter::process() {
+    float y = clampf(inputs[FILTER_INPUT].value / 50, -0.6, 0.6);
 
-      b4 = b4 - b4 * b4 * b4;
-      b0 = in;
+    inBuffer[bufferPos] = y;
 
-      double drv = params[DRIVE_PARAM].value;
-      double out = 0;
+    // 1V/oct cutoff tracking at audio rate, full attenuverter is exactly one octave per volt
+    cutoffBuffer[bufferPos] = params[CUTOFF_PARAM].value +
+                              inputs[CUTOFF_CV_INPUT].value * params[CUTOFF_CV_PARAM].value * (1.f / CUTOFF_OCTAVES);
 
-      out = clip(b4, 0.8 + drv, -(drv + 0.8)) * 10;
+    outputs[LP_OUTPUT].value = lpBuffer[bufferPos] * 50;
+    outputs[HP_OUTPUT].value = hpBuffer[bufferPos] * 50;
+    outputs[BP_OUTPUT].value = bpBuffer[bufferPos] * 50;
 
+    if (++bufferPos < FILTER_BLOCKSIZE) return;
 
-      if (outputs[LP_OUTPUT].active) {
-          outputs[LP_OUTPUT].value = out;
-      }*/
+    bufferPos = 0;
 
-    //   outputs[BP_OUTPUT].value = (float) clampd(((b3 - b4) * 60.0), -10, 10);
-    //  outputs[HP_OUTPUT].value = (float) clampd((((in - 3.0 * (b3 - b4)) - b4) * 15.0), -10, 10);
+    bool modulated = inputs[CUTOFF_CV_INPUT].active;
 
+    if (core == FILTER_CORE_ZDF) {
+        processBlock(zdfFilter, oversampling[FILTER_CORE_ZDF], modulated);
+    } else {
+        processBlock(filter, oversampling[FILTER_CORE_CLASSIC], modulated);
+    }
 }
 
 
@@ -179,3 +223,75 @@ SimpleFilterWidget::SimpleFilterWidget() {
     module->label2->box.pos = Vec(23, 300);
     addChild(module->label2);
 }
+
+
+/**
+ * @brief Context menu entry for the oversampling factor
+ */
+struct SimpleFilterOversamplingItem : MenuItem {
+    SimpleFilter *filter;
+    int factor;
+
+
+    void onAction(EventAction &e) override {
+        filter->oversampling[filter->core] = factor;
+    }
+
+
+    void step() override {
+        rightText = (filter->oversampling[filter->core] == factor) ? "✔" : "";
+        MenuItem::step();
+    }
+};
+
+
+/**
+ * @brief Context menu entry for the filter core
+ */
+struct SimpleFilterCoreItem : MenuItem {
+    SimpleFilter *filter;
+    int core;
+
+
+    void onAction(EventAction &e) override {
+        filter->core = core;
+    }
+
+
+    void step() override {
+        rightText = (filter->core == core) ? "✔" : "";
+        MenuItem::step();
+    }
+};
+
+
+/**
+ * @brief Add filter core and oversampling selection to context menu
+ * @return
+ */
+Menu *SimpleFilterWidget::createContextMenu() {
+    Menu *menu = ModuleWidget::createContextMenu();
+    SimpleFilter *simpleFilter = dynamic_cast<SimpleFilter *>(module);
+
+    menu->pushChild(construct<MenuLabel>());
+    menu->pushChild(construct<MenuLabel>(&MenuLabel::text, "Filter core"));
+    menu->pushChild(construct<SimpleFilterCoreItem>(&MenuItem::text, "Classic ladder",
+                                                    &SimpleFilterCoreItem::filter, simpleFilter,
+                                                    &SimpleFilterCoreItem::core, FILTER_CORE_CLASSIC));
+    menu->pushChild(construct<SimpleFilterCoreItem>(&MenuItem::text, "Zero-delay feedback",
+                                                    &SimpleFilterCoreItem::filter, simpleFilter,
+                                                    &SimpleFilterCoreItem::core, FILTER_CORE_ZDF));
+
+    menu->pushChild(construct<MenuLabel>());
+    menu->pushChild(construct<MenuLabel>(&MenuLabel::text, "Oversampling"));
+
+    for (int factor = 2; factor <= OVERSAMPLE_MAX; factor *= 2) {
+        menu->pushChild(construct<SimpleFilterOversamplingItem>(&MenuItem::text, stringf("%dx", factor),
+                                                                &SimpleFilterOversamplingItem::filter, simpleFilter,
+                                                                &SimpleFilterOversamplingItem::factor, factor));
+    }
+
+    addProfilerMenu(menu, simpleFilter);
+
+    return menu;
+}
@@ -1,5 +1,14 @@
-#include "dsp/Oscillator.hpp"
+#include "dsp/OscillatorBank.hpp"
+#include "dsp/BLEPOscillator.hpp"
+#include "dsp/WavetableOscillator.hpp"
 #include "LindenbergResearch.hpp"
+#include "osdialog.h"
+
+#define VCO_UNISON_MAX 16
+#define VCO_UNISON_DETUNE 0.5f // detune of the outer unison voices in semitones at full knob
+
+#define VCO_CORE_BLIT 0
+#define VCO_CORE_BLEP 1
 
 
 struct VCO : LRTModule {
@@ -11,6 +20,8 @@ struct VCO : LRTModule {
         PW_CV_PARAM,
         SHAPE_PARAM,
         PW_PARAM,
+        DETUNE_PARAM,
+        POSITION_PARAM,
         NUM_PARAMS
     };
     enum InputIds {
@@ -25,6 +36,9 @@ struct VCO : LRTModule {
         PULSE_OUTPUT,
         SAWTRI_OUTPUT,
         TRI_OUTPUT,
+        LEFT_OUTPUT,
+        RIGHT_OUTPUT,
+        WAVETABLE_OUTPUT,
         NUM_OUTPUTS
     };
     enum LightIds {
@@ -32,46 +46,286 @@ struct VCO : LRTModule {
     };
 
     BLITOscillator osc;
+    BLEPOscillator blep;
+    WavetableOscillator wavetable;
+    std::string wavetablePath;
+
+    /* oscillator core of the single voice selected by the user, applied from the audio thread */
+    int core = VCO_CORE_BLIT;
     LCDWidget *label1 = new LCDWidget(LCD_COLOR_FG, 10);
 
+    /* unison voices, 1 runs the single oscillator */
+    OscillatorBank<VCO_UNISON_MAX> unison;
+    int unisonVoices = 1;
+
+    /* equal power gains of the unison mix and the stereo spread */
+    float unisonGain = 1.f;
+    float unisonPW = -1.f; // pulse width last handed to the unison voices, -1 after a change of the voices
+    float spreadL[VCO_UNISON_MAX], spreadR[VCO_UNISON_MAX];
 
-    VCO() : LRTModule(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS) {}
 
+    VCO() : LRTModule(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS) {
+        osc.setFixedPhase(true);
 
-    void step() override;
+        /* same pitch on both cores */
+        blep.detune = osc.detune;
+    }
+
+
+    void process() override;
+    template<typename OSC>
+    void processCore(OSC &core, float fm);
+    void processUnison(float fm);
+    void updateUnison();
+    int getWaveMask();
+    void setFMMode(int fmMode);
+    void loadWavetable(const std::string &path);
+    void onSampleRateChange() override;
+    json_t *toJson() override;
+    void fromJson(json_t *rootJ) override;
 };
 
 
-void VCO::step() {
-    LRTModule::step();
+/**
+ * @brief Pass the new sample rate to all oscillator cores
+ */
+void VCO::onSampleRateChange() {
+    LRTModule::onSampleRateChange();
 
-    float fm = clampf(inputs[FM_CV_INPUT].value, -10.f, 10.f) * 400.f * quadraticBipolar(params[FM_CV_PARAM].value);
+    osc.setSampleRate(sampleRate);
+    blep.setSampleRate(sampleRate);
+    wavetable.setSampleRate(sampleRate);
+    unison.setSampleRate(sampleRate);
+}
+
+
+/**
+ * @brief Save FM mode, oscillator core, unison voices and wavetable with patch
+ * @return
+ */
+json_t *VCO::toJson() {
+    json_t *rootJ = json_object();
+    json_object_set_new(rootJ, "fmMode", json_integer(osc.getFMMode()));
+    json_object_set_new(rootJ, "core", json_integer(core));
+    json_object_set_new(rootJ, "unison", json_integer(unisonVoices));
+
+    if (!wavetablePath.empty()) {
+        json_object_set_new(rootJ, "wavetable", json_string(wavetablePath.c_str()));
+    }
+
+    return rootJ;
+}
+
+
+/**
+ * @brief Restore FM mode, oscillator core, unison voices and wavetable from patch, tables already in memory are shared
+ * @param rootJ
+ */
+void VCO::fromJson(json_t *rootJ) {
+    json_t *fmModeJ = json_object_get(rootJ, "fmMode");
+    json_t *coreJ = json_object_get(rootJ, "core");
+    json_t *unisonJ = json_object_get(rootJ, "unison");
+    json_t *wavetableJ = json_object_get(rootJ, "wavetable");
+
+    if (fmModeJ) {
+        setFMMode((int) json_integer_value(fmModeJ) == FM_MODE_THROUGH_ZERO ? FM_MODE_THROUGH_ZERO : FM_MODE_LINEAR);
+    }
+
+    if (coreJ) {
+        core = (int) json_integer_value(coreJ) == VCO_CORE_BLEP ? VCO_CORE_BLEP : VCO_CORE_BLIT;
+    }
+
+    if (unisonJ) {
+        int voices = (int) json_integer_value(unisonJ);
+        unisonVoices = voices < 1 ? 1 : (voices > VCO_UNISON_MAX ? VCO_UNISON_MAX : voices);
+    }
+
+    if (wavetableJ) {
+        loadWavetable(json_string_value(wavetableJ));
+    }
+}
+
+
+/**
+ * @brief Load a wavetable through the shared cache, the path is kept even if loading fails
+ * @param path Path of a WAV file
+ */
+void VCO::loadWavetable(const std::string &path) {
+    wavetablePath = path;
+    wavetable.setTable(WavetableCache::load(path));
+}
 
-    osc.updatePitch(inputs[VOCT_INPUT].value, clampf(fm, 0.f, 20.000f), params[FREQUENCY_PARAM].value, params[OCTAVE_PARAM].value);
 
-    float saturate = params[SHAPE_PARAM].value;
+/**
+ * @brief Set FM mode of all oscillators
+ * @param fmMode
+ */
+void VCO::setFMMode(int fmMode) {
+    osc.setFMMode(fmMode);
+    blep.setFMMode(fmMode);
+    wavetable.setFMMode(fmMode);
+    unison.setFMMode(fmMode);
+}
+
+
+/**
+ * @brief Apply the number of unison voices, voices are panned evenly from left to right
+ */
+void VCO::updateUnison() {
+    unison.setVoices(unisonVoices);
+
+    /* voices joining the unison get the pulse width with the next sample */
+    unisonPW = -1.f;
+
+    unisonGain = 1.f / sqrtf((float) unisonVoices);
+
+    for (int i = 0; i < unisonVoices; i++) {
+        float angle = (float) M_PI / 2.f * i / (unisonVoices - 1);
+
+        /* sqrt(2) keeps the level of each side equal to the mono mix */
+        spreadL[i] = cosf(angle) * unisonGain * (float) M_SQRT2;
+        spreadR[i] = sinf(angle) * unisonGain * (float) M_SQRT2;
+    }
+}
+
+
+/**
+ * @brief Waveforms of the patched outputs, the cores skip integrators and shapers of the others
+ * @return Combination of OSC_WAVE_* flags
+ */
+int VCO::getWaveMask() {
+    int mask = 0;
+
+    if (outputs[SAW_OUTPUT].active || outputs[LEFT_OUTPUT].active || outputs[RIGHT_OUTPUT].active) mask |= OSC_WAVE_SAW;
+    if (outputs[PULSE_OUTPUT].active) mask |= OSC_WAVE_PULSE;
+    if (outputs[SAWTRI_OUTPUT].active) mask |= OSC_WAVE_SAWTRI;
+    if (outputs[TRI_OUTPUT].active) mask |= OSC_WAVE_TRI;
+
+    return mask;
+}
+
+
+/**
+ * @brief Process all unison voices in one batch, the pitch is computed once for all voices
+ * @param fm Frequency modulation in Hz
+ */
+void VCO::processUnison(float fm) {
+    if (unison.getVoices() != unisonVoices) {
+        updateUnison();
+    }
+
+    float detune = params[DETUNE_PARAM].value;
     float pw = params[PW_CV_PARAM].value;
 
-    if (osc.saturate != saturate) {
-        osc.setSaturate(quadraticBipolar(saturate));
+    unison.setDetune(detune * detune * VCO_UNISON_DETUNE);
+    unison.updatePitch(inputs[VOCT_INPUT].value, 0.f, params[FREQUENCY_PARAM].value, params[OCTAVE_PARAM].value);
+    unison.setFM(fm);
+
+    if (unisonPW != pw) {
+        unisonPW = pw;
+
+        for (int i = 0; i < unisonVoices; i++) {
+            unison.setPulseWidth(i, pw);
+        }
+    }
+
+    unison.setWaveMask(getWaveMask());
+    unison.process();
+
+    float saw = 0.f, pulse = 0.f, sawtri = 0.f, tri = 0.f;
+    float left = 0.f, right = 0.f;
+
+    for (int i = 0; i < unisonVoices; i++) {
+        float s = unison.getSawWave(i);
+
+        saw += s;
+        pulse += unison.getPulseWave(i);
+        sawtri += unison.getSawTriWave(i);
+        tri += unison.getTriangleWave(i);
+
+        /* stereo spread of the supersaw */
+        left += s * spreadL[i];
+        right += s * spreadR[i];
+    }
+
+    outputs[SAW_OUTPUT].value = saw * unisonGain;
+    outputs[PULSE_OUTPUT].value = pulse * unisonGain;
+    outputs[SAWTRI_OUTPUT].value = sawtri * unisonGain;
+    outputs[TRI_OUTPUT].value = tri * unisonGain;
+    outputs[LEFT_OUTPUT].value = left;
+    outputs[RIGHT_OUTPUT].value = right;
+}
+
+
+void VCO::process() {
+    float fm = clampf(inputs[FM_CV_INPUT].value, -10.f, 10.f) * 400.f * quadraticBipolar(params[FM_CV_PARAM].value);
+    float pitch;
+
+    if (unisonVoices > 1) {
+        processUnison(fm);
+
+        if (cnt % 1200 == 0) {
+            label1->text = stringf("%.2f Hz", unison.getUnisonFrequency());
+        }
+
+        pitch = unison.getUnisonFrequency();
+    } else {
+        float saturate = params[SHAPE_PARAM].value;
+
+        if (osc.saturate != saturate) {
+            osc.setSaturate(quadraticBipolar(saturate));
+        }
+
+        if (core == VCO_CORE_BLEP) {
+            processCore(blep, fm);
+            pitch = blep.getPitch();
+        } else {
+            processCore(osc, fm);
+            pitch = osc.getPitch();
+        }
     }
 
-    if (osc.pw != pw) {
-        osc.setPulseWidth(pw);
+    /* the wavetable follows the pitch the active core already computed */
+    if (outputs[WAVETABLE_OUTPUT].active) {
+        wavetable.setFrequency(pitch);
+        wavetable.setFM(fm);
+        wavetable.setPosition(params[POSITION_PARAM].value);
+        wavetable.proccess();
+
+        outputs[WAVETABLE_OUTPUT].value = wavetable.getOut();
     }
+}
 
-    osc.proccess();
 
-    outputs[SAW_OUTPUT].value = osc.saw;
-    //   outputs[SAW_OUTPUT].value = osc.saw;
+/**
+ * @brief Process the selected single oscillator core, both share the same interface
+ * @param core BLITOscillator or BLEPOscillator
+ * @param fm Frequency modulation in Hz
+ */
+template<typename OSC>
+void VCO::processCore(OSC &core, float fm) {
+    core.updatePitch(inputs[VOCT_INPUT].value, 0.f, params[FREQUENCY_PARAM].value, params[OCTAVE_PARAM].value);
+    core.setFM(fm);
 
-    outputs[PULSE_OUTPUT].value = osc.pulse;
-    outputs[SAWTRI_OUTPUT].value = osc.sawtri;
+    float pw = params[PW_CV_PARAM].value;
 
-    outputs[TRI_OUTPUT].value = osc.tri;
+    if (core.pw != pw) {
+        core.setPulseWidth(pw);
+    }
+
+    core.setWaveMask(getWaveMask());
+    core.proccess();
+
+    outputs[SAW_OUTPUT].value = core.getSawWave();
+    outputs[PULSE_OUTPUT].value = core.getPulseWave();
+    outputs[SAWTRI_OUTPUT].value = core.getSawTriWave();
+    outputs[TRI_OUTPUT].value = core.getTriangleWave();
+
+    outputs[LEFT_OUTPUT].value = core.getSawWave();
+    outputs[RIGHT_OUTPUT].value = core.getSawWave();
 
     if (cnt % 1200 == 0) {
-        label1->text = stringf("%.2f Hz", osc.freq);
+        label1->text = stringf("%.2f Hz", core.getFrequency());
     }
 }
 
@@ -112,6 +366,8 @@ VCOWidget::VCOWidget() {
     addParam(createParam<LRSmallKnob>(Vec(15, 267), module, VCO::FM_CV_PARAM, -1.f, 1.f, 0.f));
     addParam(createParam<LRSmallKnob>(Vec(65, 111.5), module, VCO::PW_CV_PARAM, 0.02f, 1.f, 1.f));
     addParam(createParam<LRSmallKnob>(Vec(118, 59), module, VCO::SHAPE_PARAM, 0.4f, 1.f, 1.f));
+    addParam(createParam<LRSmallKnob>(Vec(183, 62), module, VCO::DETUNE_PARAM, 0.f, 1.f, 0.3f));
+    addParam(createParam<LRSmallKnob>(Vec(183, 220), module, VCO::POSITION_PARAM, 0.f, 1.f, 0.f));
 
 
     // ***** MAIN KNOBS ******
@@ -132,9 +388,147 @@ VCOWidget::VCOWidget() {
     addOutput(createOutput<IOPort>(Vec(49, 319), module, VCO::PULSE_OUTPUT));
     addOutput(createOutput<IOPort>(Vec(86, 319), module, VCO::SAWTRI_OUTPUT));
     addOutput(createOutput<IOPort>(Vec(124, 319), module, VCO::TRI_OUTPUT));
+
+    addOutput(createOutput<IOPort>(Vec(180, 108), module, VCO::LEFT_OUTPUT));
+    addOutput(createOutput<IOPort>(Vec(180, 153), module, VCO::RIGHT_OUTPUT));
+    addOutput(createOutput<IOPort>(Vec(180, 266), module, VCO::WAVETABLE_OUTPUT));
     // ***** OUTPUTS *********
 
     module->label1->box.pos = Vec(30, 310);
 
     addChild(module->label1);
 }
+
+
+/**
+ * @brief Context menu entry for the FM mode
+ */
+struct VCOFMModeItem : MenuItem {
+    VCO *vco;
+    int fmMode;
+
+
+    void onAction(EventAction &e) override {
+        vco->setFMMode(fmMode);
+    }
+
+
+    void step() override {
+        rightText = (vco->osc.getFMMode() == fmMode) ? "✔" : "";
+        MenuItem::step();
+    }
+};
+
+
+/**
+ * @brief Context menu entry for the oscillator core, unison voices always run the BLIT bank
+ */
+struct VCOCoreItem : MenuItem {
+    VCO *vco;
+    int core;
+
+
+    void onAction(EventAction &e) override {
+        vco->core = core;
+    }
+
+
+    void step() override {
+        rightText = (vco->core == core) ? "✔" : "";
+        MenuItem::step();
+    }
+};
+
+
+/**
+ * @brief Context menu entry for the number of unison voices
+ */
+struct VCOUnisonItem : MenuItem {
+    VCO *vco;
+    int voices;
+
+
+    void onAction(EventAction &e) override {
+        vco->unisonVoices = voices;
+    }
+
+
+    void step() override {
+        rightText = (vco->unisonVoices == voices) ? "✔" : "";
+        MenuItem::step();
+    }
+};
+
+
+/**
+ * @brief Context menu entry to load a wavetable from a WAV file
+ */
+struct VCOWavetableItem : MenuItem {
+    VCO *vco;
+
+
+    void onAction(EventAction &e) override {
+        char *path = osdialog_file(OSDIALOG_OPEN, nullptr, nullptr, nullptr);
+
+        if (path) {
+            vco->loadWavetable(path);
+            free(path);
+        }
+    }
+
+
+    void step() override {
+        /* file name of the current table */
+        std::string path = vco->wavetablePath;
+        size_t sep = path.find_last_of("/\\");
+
+        rightText = sep == std::string::npos ? path : path.substr(sep + 1);
+        MenuItem::step();
+    }
+};
+
+
+/**
+ * @brief Add FM mode, core and unison selection and wavetable loading to context menu
+ * @return
+ */
+Menu *VCOWidget::createContextMenu() {
+    Menu *menu = ModuleWidget::createContextMenu();
+    VCO *vco = dynamic_cast<VCO *>(module);
+
+    menu->pushChild(construct<MenuLabel>());
+    menu->pushChild(construct<MenuLabel>(&MenuLabel::text, "FM mode"));
+    menu->pushChild(construct<VCOFMModeItem>(&MenuItem::text, "Linear",
+                                             &VCOFMModeItem::vco, vco,
+                                             &VCOFMModeItem::fmMode, FM_MODE_LINEAR));
+    menu->pushChild(construct<VCOFMModeItem>(&MenuItem::text, "Through-zero",
+                                             &VCOFMModeItem::vco, vco,
+                                             &VCOFMModeItem::fmMode, FM_MODE_THROUGH_ZERO));
+
+    menu->pushChild(construct<MenuLabel>());
+    menu->pushChild(construct<MenuLabel>(&MenuLabel::text, "Oscillator core (unison is always BLIT)"));
+    menu->pushChild(construct<VCOCoreItem>(&MenuItem::text, "BLIT",
+                                           &VCOCoreItem::vco, vco,
+                                           &VCOCoreItem::core, VCO_CORE_BLIT));
+    menu->pushChild(construct<VCOCoreItem>(&MenuItem::text, "PolyBLEP",
+                                           &VCOCoreItem::vco, vco,
+                                           &VCOCoreItem::core, VCO_CORE_BLEP));
+
+    menu->pushChild(construct<MenuLabel>());
+    menu->pushChild(construct<MenuLabel>(&MenuLabel::text, "Unison"));
+
+    static const int unisonVoices[] = {1, 3, 5, 7, 9, 12, 16};
+
+    for (int voices : unisonVoices) {
+        menu->pushChild(construct<VCOUnisonItem>(&MenuItem::text, voices > 1 ? stringf("%d voices", voices) : "Off",
+                                                 &VCOUnisonItem::vco, vco,
+                                                 &VCOUnisonItem::voices, voices));
+    }
+
+    menu->pushChild(construct<MenuLabel>());
+    menu->pushChild(construct<VCOWavetableItem>(&MenuItem::text, "Load wavetable...", &VCOWavetableItem::vco, vco));
+
+    addProfilerMenu(menu, vco);
+
+    return menu;
+}
@@ -0,0 +1,158 @@
+#include "dsp/OscillatorBank.hpp"
+#include "LindenbergResearch.hpp"
+
+#define VCOBANK_VOICES 16
+
+
+struct VCOBank : LRTModule {
+    enum ParamIds {
+        FREQUENCY_PARAM,
+        OCTAVE_PARAM,
+        PW_PARAM,
+        NUM_PARAMS
+    };
+
+    enum InputIds {
+        VOCT_INPUT,
+        NUM_INPUTS = VOCT_INPUT + VCOBANK_VOICES
+    };
+
+    enum OutputIds {
+        SAW_OUTPUT,
+        PULSE_OUTPUT,
+        SAWTRI_OUTPUT,
+        TRI_OUTPUT,
+        NUM_OUTPUTS
+    };
+
+    enum LightIds {
+        NUM_LIGHTS
+    };
+
+    OscillatorBank<VCOBANK_VOICES> osc;
+
+    VCOBank() : LRTModule(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS) {}
+
+
+    void process() override;
+    void onSampleRateChange() override;
+};
+
+
+/**
+ * @brief Pass the new sample rate to all oscillator voices
+ */
+void VCOBank::onSampleRateChange() {
+    LRTModule::onSampleRateChange();
+
+    osc.setSampleRate(sampleRate);
+}
+
+
+void VCOBank::process() {
+    float tune = params[FREQUENCY_PARAM].value;
+    float oct = params[OCTAVE_PARAM].value;
+    float pw = params[PW_PARAM].value;
+
+    /* voices above the highest patched V/Oct input are not processed */
+    int active = 0;
+
+    for (int i = 0; i < VCOBANK_VOICES; i++) {
+        if (inputs[VOCT_INPUT + i].active) active = i + 1;
+    }
+
+    if (active == 0) {
+        outputs[SAW_OUTPUT].value = 0.f;
+        outputs[PULSE_OUTPUT].value = 0.f;
+        outputs[SAWTRI_OUTPUT].value = 0.f;
+        outputs[TRI_OUTPUT].value = 0.f;
+        return;
+    }
+
+    osc.setVoices(active);
+
+    for (int i = 0; i < active; i++) {
+        osc.updatePitch(i, inputs[VOCT_INPUT + i].value, 0.f, tune, oct);
+        osc.setPulseWidth(i, pw);
+    }
+
+    osc.process();
+
+    /* mix all voices with a patched V/Oct input, equal power */
+    float saw = 0.f, pulse = 0.f, sawtri = 0.f, tri = 0.f;
+    int voices = 0;
+
+    for (int i = 0; i < active; i++) {
+        if (!inputs[VOCT_INPUT + i].active) continue;
+
+        saw += osc.getSawWave(i);
+        pulse += osc.getPulseWave(i);
+        sawtri += osc.getSawTriWave(i);
+        tri += osc.getTriangleWave(i);
+        voices++;
+    }
+
+    float gain = 1.f / sqrtf((float) voices);
+
+    outputs[SAW_OUTPUT].value = saw * gain;
+    outputs[PULSE_OUTPUT].value = pulse * gain;
+    outputs[SAWTRI_OUTPUT].value = sawtri * gain;
+    outputs[TRI_OUTPUT].value = tri * gain;
+}
+
+
+VCOBankWidget::VCOBankWidget() {
+    VCOBank *module = new VCOBank();
+
+    setModule(module);
+    box.size = Vec(VCOBANK_WIDTH * RACK_GRID_WIDTH, RACK_GRID_HEIGHT);
+
+    {
+        SVGPanel *panel = new SVGPanel();
+        panel->box.size = box.size;
+        panel->setBackground(SVG::load(assetPlugin(plugin, "res/VCOBank.svg")));
+        addChild(panel);
+    }
+
+    // ***** SCREWS **********
+    addChild(createScrew<ScrewDarkA>(Vec(15, 2)));
+    addChild(createScrew<ScrewDarkA>(Vec(box.size.x - 30, 2)));
+    addChild(createScrew<ScrewDarkA>(Vec(15, 365)));
+    addChild(createScrew<ScrewDarkA>(Vec(box.size.x - 30, 365)));
+    // ***** SCREWS **********
+
+    // ***** MAIN KNOBS ******
+    addParam(createParam<LRBigKnob>(Vec(122.5, 70), module, VCOBank::FREQUENCY_PARAM, -15.f, 15.f, 0.f));
+    addParam(createParam<LRToggleKnob>(Vec(122.5, 150), module, VCOBank::OCTAVE_PARAM, -3.f, 3.f, 0.f));
+    addParam(createParam<LRSmallKnob>(Vec(138, 235), module, VCOBank::PW_PARAM, 0.1f, 1.f, 1.f));
+    // ***** MAIN KNOBS ******
+
+    // ***** INPUTS **********
+    for (int i = 0; i < VCOBANK_VOICES; i++) {
+        float x = 15 + (i / 8) * 40;
+        float y = 62 + (i % 8) * 34;
+
+        addInput(createInput<IOPort>(Vec(x, y), module, VCOBank::VOCT_INPUT + i));
+    }
+    // ***** INPUTS **********
+
+    // ***** OUTPUTS *********
+    addOutput(createOutput<IOPort>(Vec(210, 70), module, VCOBank::SAW_OUTPUT));
+    addOutput(createOutput<IOPort>(Vec(210, 130), module, VCOBank::PULSE_OUTPUT));
+    addOutput(createOutput<IOPort>(Vec(210, 190), module, VCOBank::SAWTRI_OUTPUT));
+    addOutput(createOutput<IOPort>(Vec(210, 250), module, VCOBank::TRI_OUTPUT));
+    // ***** OUTPUTS *********
+}
+
+
+/**
+ * @brief Add profiling to context menu
+ * @return
+ */
+Menu *VCOBankWidget::createContextMenu() {
+    Menu *menu = ModuleWidget::createContextMenu();
+
+    addProfilerMenu(menu, dynamic_cast<VCOBank *>(module));
+
+    return menu;
+}
@@ -0,0 +1,340 @@
+#include "DSPMath.hpp"
+#include "BLEPOscillator.hpp"
+
+using namespace rack;
+
+
+/**
+ * @brief Set oscillator state back
+ */
+void BLEPOscillator::reset() {
+    freq = 0.f;
+    phase = 0;
+    incr = 0;
+    dt = 0.f;
+    idt = 0.f;
+    fmHz = 0.f;
+    fmMode = FM_MODE_LINEAR;
+    waveMask = OSC_WAVE_ALL;
+    detune = rand.nextFloat(-0.281273f, 0.2912846f);
+
+    saw = 0.f;
+    ramp = 0.f;
+    pulse = 0.f;
+    sawtri = 0.f;
+    tri = 0.f;
+
+    pitch = PitchCache();
+
+    /* initial slopes, the setter only recomputes on change */
+    pw = 0.f;
+    setPulseWidth(1.f);
+
+    /* force recalculation of variables */
+    setFrequency(NOTE_C4);
+}
+
+
+/**
+ * @brief Default constructor
+ */
+BLEPOscillator::BLEPOscillator() {
+    sr = engineGetSampleRate();
+    isr = 1.f / sr;
+
+    reset();
+}
+
+
+/**
+ * @brief Default destructor
+ */
+BLEPOscillator::~BLEPOscillator() {}
+
+
+/**
+ * @brief Get sample rate
+ * @return
+ */
+float BLEPOscillator::getSampleRate() const {
+    return sr;
+}
+
+
+/**
+ * @brief Set sample rate, recomputes all increments on change
+ * @param sr
+ */
+void BLEPOscillator::setSampleRate(float sr) {
+    if (BLEPOscillator::sr != sr) {
+        BLEPOscillator::sr = sr;
+        isr = 1.f / sr;
+
+        invalidate();
+    }
+}
+
+
+/**
+ * @brief Seed the analogue detune, for reproducible renders
+ * @param seed
+ */
+void BLEPOscillator::setSeed(uint32_t seed) {
+    rand.seed(seed);
+    detune = rand.nextFloat(-0.281273f, 0.2912846f);
+}
+
+
+/**
+ * @brief Get current frequency
+ * @return
+ */
+float BLEPOscillator::getFrequency() const {
+    return freq;
+}
+
+
+/**
+ * @brief Get frequency of the last updatePitch() without analogue detune and FM
+ * @return
+ */
+float BLEPOscillator::getPitch() const {
+    return pitch.freq;
+}
+
+
+/**
+ * @brief Set frequency
+ * @param freq
+ */
+void BLEPOscillator::setFrequency(float freq) {
+    /* just set if frequency differs from old value */
+    if (BLEPOscillator::freq != freq) {
+        BLEPOscillator::freq = freq;
+
+        /* force recalculation of variables */
+        invalidate();
+    }
+}
+
+
+/**
+ * @brief Get current pulse-width
+ * @return
+ */
+float BLEPOscillator::getPulseWidth() const {
+    return pw;
+}
+
+
+/**
+ * @brief Set current pulse-width, 1 is a square wave like BLITOscillator
+ * @param pw 0.1..1
+ */
+void BLEPOscillator::setPulseWidth(float pw) {
+    if (pw < 0.1f) pw = 0.1f;
+    if (pw > 1.f) pw = 1.f;
+
+    if (BLEPOscillator::pw == pw) return;
+
+    BLEPOscillator::pw = pw;
+
+    /* the triangle rises while the pulse is high */
+    duty = pw * 0.5f;
+    rise = 2.f / duty;
+    fall = 2.f / (1.f - duty);
+}
+
+
+/**
+ * @brief Get FM mode
+ * @return FM_MODE_LINEAR or FM_MODE_THROUGH_ZERO
+ */
+int BLEPOscillator::getFMMode() const {
+    return fmMode;
+}
+
+
+/**
+ * @brief Set FM mode, through-zero lets the modulated frequency go negative and run the phase backwards
+ * @param fmMode FM_MODE_LINEAR or FM_MODE_THROUGH_ZERO
+ */
+void BLEPOscillator::setFMMode(int fmMode) {
+    if (BLEPOscillator::fmMode != fmMode) {
+        BLEPOscillator::fmMode = fmMode;
+
+        /* force recalculation of variables */
+        invalidate();
+    }
+}
+
+
+/**
+ * @brief Get waveforms computed by proccess()
+ * @return
+ */
+int BLEPOscillator::getWaveMask() const {
+    return waveMask;
+}
+
+
+/**
+ * @brief Compute only the requested waveforms, the others keep their last value
+ * @param waveMask Combination of OSC_WAVE_* flags
+ */
+void BLEPOscillator::setWaveMask(int waveMask) {
+    BLEPOscillator::waveMask = waveMask;
+}
+
+
+/**
+ * @brief Ramp waveform current
+ * @return
+ */
+float BLEPOscillator::getRampWave() const {
+    return ramp;
+}
+
+
+/**
+ * @brief Saw waveform current
+ * @return
+ */
+float BLEPOscillator::getSawWave() const {
+    return saw;
+}
+
+
+/**
+ * @brief Pulse waveform current
+ * @return
+ */
+float BLEPOscillator::getPulseWave() const {
+    return pulse;
+}
+
+
+/**
+ * @brief SawTri waveform current
+ * @return
+ */
+float BLEPOscillator::getSawTriWave() const {
+    return sawtri;
+}
+
+
+/**
+ * @brief Triangle waveform current
+ * @return
+ */
+float BLEPOscillator::getTriangleWave() const {
+    return tri;
+}
+
+
+/**
+ * @brief Process polyBLEP oscillator
+ *
+ * The residuals are symmetric to the discontinuity, so they stay correct with the absolute increment
+ * while the phase runs backwards in through-zero mode.
+ */
+void BLEPOscillator::proccess() {
+    /* phase locked loop, wraps on overflow */
+    phase += (uint32_t) incr;
+
+    /* nothing patched, only keep the phase running */
+    if (waveMask == 0) return;
+
+    /* 24 bit of phase fit into the mantissa and convert as signed int */
+    float t = (int32_t) (phase >> 8) * (1.f / 16777216.f);
+
+    /* phase relative to the falling edge of the pulse */
+    float t2 = t - duty;
+    if (t2 < 0.f) t2 += 1.f;
+
+    float s = 0.f, v = 0.f;
+
+    if (waveMask & (OSC_WAVE_SAW | OSC_WAVE_RAMP | OSC_WAVE_SAWTRI)) {
+        s = 2.f * t - 1.f - polyBLEP(t, dt, idt);
+
+        saw = s * BLEP_LEVEL;
+        ramp = -saw;
+    }
+
+    if (waveMask & OSC_WAVE_PULSE) {
+        float p = (t < duty ? 1.f : -1.f) + polyBLEP(t, dt, idt) - polyBLEP(t2, dt, idt);
+
+        pulse = p * BLEP_LEVEL;
+    }
+
+    if (waveMask & (OSC_WAVE_TRI | OSC_WAVE_SAWTRI)) {
+        v = t < duty ? rise * t - 1.f : 1.f - fall * t2;
+
+        /* corners at both edges of the pulse, slope change per sample is (rise + fall) * dt */
+        v += (rise + fall) * dt * (polyBLAMP(t, dt, idt) - polyBLAMP(t2, dt, idt));
+
+        tri = v * BLEP_LEVEL;
+    }
+
+    /* saw plus the integrated pulse like BLITOscillator, scaled back to full level */
+    if (waveMask & OSC_WAVE_SAWTRI) {
+        sawtri = (s + pw * v) / (1.f + pw) * BLEP_LEVEL;
+    }
+}
+
+
+/**
+ * @brief ReCompute basic parameter
+ */
+void BLEPOscillator::invalidate() {
+    hzIncr = isr;
+    hzIncrFixed = 4294967296.f * isr;
+    fmax = sr * 0.45f;
+
+    updateIncrement();
+}
+
+
+/**
+ * @brief Compute the phase increments of the modulated frequency
+ */
+void BLEPOscillator::updateIncrement() {
+    float f = getModulatedFrequency();
+
+    incr = (int32_t) (f * hzIncrFixed);
+    dt = fabsf(f) * hzIncr;
+    idt = dt > 0.f ? 1.f / dt : 0.f;
+}
+
+
+/**
+ * @brief Get frequency with FM applied, limited to the range of the FM mode
+ * @return
+ */
+float BLEPOscillator::getModulatedFrequency() const {
+    return clampModulated(freq + fmHz, fmax, fmMode);
+}
+
+
+/**
+ * @brief Audio rate frequency modulation, sets the phase increment directly
+ * @param fm Frequency offset in Hz
+ */
+void BLEPOscillator::setFM(float fm) {
+    if (fmHz == fm) return;
+
+    fmHz = fm;
+
+    updateIncrement();
+}
+
+
+/**
+ * @brief Translate from control voltage to frequency
+ * @param cv ControlVoltage from MIDI2CV
+ * @param fm Frequency offset in Hz, for audio rate FM use setFM()
+ * @param oct Octave
+ */
+void BLEPOscillator::updatePitch(float cv, float fm, float tune, float oct) {
+    setFrequency(pitch.hz(cv, tune, oct) + detune + fm);
+}
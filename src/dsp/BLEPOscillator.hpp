@@ -0,0 +1,92 @@
+#pragma once
+
+#include "DSPMath.hpp"
+#include "Oscillator.hpp"
+
+#define BLEP_LEVEL 4.2f // peak level, same as the shaped BLIT waveforms
+
+using namespace rack;
+
+
+/**
+ * @brief Oscillator core with polyBLEP residual correction, same interface as BLITOscillator
+ *
+ * The naive waveforms are computed from a fixed-point phase and only the two samples around every
+ * discontinuity (polyBLEP) and every corner of the triangle (polyBLAMP) get a polynomial correction.
+ * There are no integrators, DC blockers or harmonic bands, so the waveforms need no shaping and cost
+ * a few multiplies each, for the price of more aliasing in the top octaves.
+ */
+struct BLEPOscillator {
+    float freq;      // oscillator frequency
+    float pw;        // pulse-width value
+    uint32_t phase;  // current phase, one cycle is 2^32
+    int32_t incr;    // current phase increment, negative while running backwards
+    float dt, idt;   // absolute phase increment in cycles and its reciprocal
+    float fmHz;      // audio rate frequency modulation in Hz
+    int fmMode;      // linear or through-zero FM
+    int waveMask;    // waveforms computed by proccess(), OSC_WAVE_*
+    float sr, isr;   // sample rate and its reciprocal
+    float hzIncr, hzIncrFixed; // phase increments of 1 Hz, cached from the sample rate
+    float fmax;      // highest modulated frequency
+    float detune;    // analogue detune
+    Randomizer rand; // randomizer
+
+    /* duty cycle and triangle slopes of the current pulse-width */
+    float duty, rise, fall;
+
+    /* currents of waveforms */
+    float ramp;
+    float saw;
+    float pulse;
+    float sawtri;
+    float tri;
+
+    /* frequency of the last pitch CV, octave and tune */
+    PitchCache pitch;
+
+    BLEPOscillator();
+    ~BLEPOscillator();
+
+    /**
+     * @brief Proccess next sample for output
+     */
+    void proccess();
+
+
+    /**
+     * @brief ReCompute states on change
+     */
+    void invalidate();
+
+
+    /**
+     * @brief Reset oscillator
+     */
+    void reset();
+
+
+    void updatePitch(float cv, float fm, float tune, float oct);
+    void setFM(float fm);
+    float getModulatedFrequency() const;
+    void updateIncrement();
+
+    /* common getter and setter */
+    float getSampleRate() const;
+    void setSampleRate(float sr);
+    void setSeed(uint32_t seed);
+    float getFrequency() const;
+    float getPitch() const;
+    void setFrequency(float freq);
+    float getPulseWidth() const;
+    void setPulseWidth(float pw);
+    int getFMMode() const;
+    void setFMMode(int fmMode);
+    int getWaveMask() const;
+    void setWaveMask(int waveMask);
+
+    float getRampWave() const;
+    float getSawWave() const;
+    float getPulseWave() const;
+    float getSawTriWave() const;
+    float getTriangleWave() const;
+};
@@ -1,11 +1,30 @@
 #pragma once
 
+#include "DSPHost.hpp"
+
 namespace rack {
 
     /**
      * @brief Base class for all signal processors
+     *
+     * Every effect keeps its own sample rate, taken from the engine on construction and updated with
+     * setSampleRate(), so no processing path has to ask the engine.
      */
     struct DSPEffect {
+    protected:
+        float sr;  // sample rate
+        float isr; // 1 / sample rate
+
+    public:
+
+        DSPEffect() {
+            sr = engineGetSampleRate();
+            isr = 1.f / sr;
+        }
+
+
+        virtual ~DSPEffect() {}
+
 
         /**
          * @brief Method for mark parameters as invalidate to trigger recalculation
@@ -18,6 +37,37 @@ namespace rack {
          * @return
          */
         virtual void process() {};
+
+
+        /**
+         * @brief Called after the sample rate changed, recomputes everything by default
+         */
+        virtual void onSampleRateChange() {
+            invalidate();
+        }
+
+
+        /**
+         * @brief Get sample rate
+         * @return
+         */
+        float getSampleRate() const {
+            return sr;
+        }
+
+
+        /**
+         * @brief Set sample rate, calls onSampleRateChange() if it differs
+         * @param sr
+         */
+        void setSampleRate(float sr) {
+            if (DSPEffect::sr != sr) {
+                DSPEffect::sr = sr;
+                isr = 1.f / sr;
+
+                onSampleRateChange();
+            }
+        }
     };
 
-}
\ No newline at end of file
+}
@@ -0,0 +1,56 @@
+#include "DSPHost.hpp"
+
+#ifdef LRT_STANDALONE
+
+#include <atomic>
+#include <cstdarg>
+
+namespace rack {
+
+    static std::atomic<float> sampleRate(STANDALONE_SAMPLE_RATE);
+
+
+    /**
+     * @brief Current sample rate of the host
+     * @return
+     */
+    float engineGetSampleRate() {
+        return sampleRate;
+    }
+
+
+    /**
+     * @brief Duration of one sample
+     * @return
+     */
+    float engineGetSampleTime() {
+        return 1.f / sampleRate;
+    }
+
+
+    /**
+     * @brief Set the sample rate of the host, DSP objects created afterwards start with it
+     * @param sampleRate
+     */
+    void engineSetSampleRate(float sampleRate) {
+        rack::sampleRate = sampleRate;
+    }
+
+
+    /**
+     * @brief Print a warning to stderr, format as printf()
+     * @param format
+     */
+    void warn(const char *format, ...) {
+        va_list args;
+        va_start(args, format);
+
+        fprintf(stderr, "[warning] ");
+        vfprintf(stderr, format, args);
+        fprintf(stderr, "\n");
+
+        va_end(args);
+    }
+}
+
+#endif
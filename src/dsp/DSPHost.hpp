@@ -0,0 +1,50 @@
+#pragma once
+
+/**
+ * Host interface of the DSP code
+ *
+ * Inside the plugin this is Rack itself. Built with LRT_STANDALONE, the few Rack functions used by src/dsp are
+ * declared here instead and provided by DSPHost.cpp, so the DSP code links into benchmarks and tools without
+ * Rack. The signatures follow Rack 0.5, the sample rate is set by the host with engineSetSampleRate().
+ */
+
+#ifdef LRT_STANDALONE
+
+#include <cmath>
+#include <cstdio>
+#include <string>
+
+#define STANDALONE_SAMPLE_RATE 44100.f // until the host sets one
+
+namespace rack {
+
+    float engineGetSampleRate();
+    float engineGetSampleTime();
+    void engineSetSampleRate(float sampleRate);
+
+    void warn(const char *format, ...);
+
+
+    /**
+     * @brief Limit x to min..max, same as in Rack
+     */
+    inline float clampf(float x, float min, float max) {
+        return fmaxf(fminf(x, max), min);
+    }
+
+
+    /**
+     * @brief x^2 with the sign of x, same as in Rack
+     */
+    inline float quadraticBipolar(float x) {
+        float x2 = x * x;
+        return x >= 0.f ? x2 : -x2;
+    }
+}
+
+#else
+
+#include "rack.hpp"
+#include "engine.hpp"
+
+#endif
@@ -1,5 +1,20 @@
 #include "DSPMath.hpp"
-#include "engine.hpp"
+#include "DSPHost.hpp"
+#include <atomic>
+
+
+/* shared read-only sine table */
+const SineTable sineTable;
+
+
+/**
+ * @brief Fill sine table with one period plus guard point for interpolation
+ */
+SineTable::SineTable() {
+    for (int i = 0; i <= SINE_TABLE_SIZE; i++) {
+        data[i] = (float) sin(2. * M_PI * i / SINE_TABLE_SIZE);
+    }
+}
 
 
 /**
@@ -127,15 +142,27 @@ float wrapTWOPI(float n) {
 /**
  * @brief Get PLL increment depending on frequency
  * @param frq Frequency
+ * @param isr 1 / sample rate
  * @return  PLL increment
  */
-float getPhaseIncrement(float frq) {
-    return TWOPI * frq / engineGetSampleRate();
+float getPhaseIncrement(float frq, float isr) {
+    return TWOPI * frq * isr;
 }
 
 
 /**
- * @brief Actual BLIT core computation
+ * @brief Get fixed-point PLL increment depending on frequency, negative frequencies wrap around
+ * @param frq Frequency
+ * @param isr 1 / sample rate
+ * @return PLL increment, one cycle is 2^32
+ */
+uint32_t getPhaseIncrementFixed(float frq, float isr) {
+    return (uint32_t) (int64_t) ((double) frq * isr * 4294967296.);
+}
+
+
+/**
+ * @brief Actual BLIT core computation, reference version using sinf()
  * @param N Harmonics
  * @param phase Current phase value
  * @return
@@ -148,14 +175,20 @@ float BLITcore(float N, float phase) {
 
 
 /**
- * @brief BLIT generator based on current phase
+ * @brief BLIT generator based on current phase, table driven (see BLITKernel)
  * @param N Harmonics
  * @param phase Current phase of PLL
  * @return
  */
 float BLIT(float N, float phase) {
     if (phase == 0.f) return 1.f;
-    else return BLITcore(N, phase);
+
+    float t = phase * (1.f / TWOPI);
+    float den = sineTable.lookup(0.5f * t);
+
+    if (den == 0.f) return 1.f;
+
+    return (sineTable.lookup((clipl(N - 1, 0.f) + 0.5f) * t) / den - 1.f) * 2;
 }
 
 
@@ -204,26 +237,106 @@ double LP6DBFilter::filter(double x) {
  */
 void LP6DBFilter::updateFrequency(float fc, int factor) {
     this->fc = fc;
+    this->factor = factor;
     RC = 1.f / (this->fc * TWOPI);
-    dt = 1.f / engineGetSampleRate() * factor;
+    dt = 1.f / sr * factor;
     alpha = dt / (RC + dt);
 }
 
 
 /**
- * @brief Init randomizer
+ * @brief Set sample rate and recompute the coefficient
+ * @param sr
+ */
+void LP6DBFilter::setSampleRate(float sr) {
+    this->sr = sr;
+    updateFrequency(fc, factor);
+}
+
+
+/**
+ * @brief Init randomizer with a seed derived from the instance count, so renders are
+ * reproducible as long as the objects are created in the same order
  */
-Randomizer::Randomizer() {}
+Randomizer::Randomizer() {
+    static std::atomic<uint32_t> instances(0);
+    seed(instances.fetch_add(1, std::memory_order_relaxed));
+}
 
 
 /**
- * @brief Return next random float in the range of 0.0 - 1.0
- * @return Random number
+ * @brief Init randomizer with a given seed
+ * @param seed
  */
-float Randomizer::nextFloat(float start, float stop) {
-    static std::default_random_engine e;
-    static std::uniform_real_distribution<> dis(start, stop); // rage 0 - 1
-    return (float) dis(e);
+Randomizer::Randomizer(uint32_t seed) {
+    Randomizer::seed(seed);
+}
+
+
+/**
+ * @brief Reset generator to a given seed, any value is valid
+ * @param seed
+ */
+void Randomizer::seed(uint32_t seed) {
+    /* scramble seed (murmur3 finalizer) as xorshift does not like small or zero states */
+    seed += 0x9E3779B9u;
+    seed ^= seed >> 16;
+    seed *= 0x85EBCA6Bu;
+    seed ^= seed >> 13;
+    seed *= 0xC2B2AE35u;
+    seed ^= seed >> 16;
+
+    state = (seed != 0) ? seed : 0x9E3779B9u;
+}
+
+
+/**
+ * @brief Fill buffer with random floats in the range of start - stop
+ * @param dst Destination buffer
+ * @param n Number of samples
+ * @param start Lower bound
+ * @param stop Upper bound
+ */
+void Randomizer::fill(float *dst, int n, float start, float stop) {
+    uint32_t x = state;
+    float scale = (stop - start) * (1.f / 16777216.f);
+
+    for (int i = 0; i < n; i++) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        dst[i] = start + (x >> 8) * scale;
+    }
+
+    state = x;
+}
+
+
+/**
+ * @brief Init all lanes like default constructed randomizers
+ */
+RandomizerSSE::RandomizerSSE() {
+    alignas(16) uint32_t lanes[4];
+
+    for (int i = 0; i < 4; i++) {
+        lanes[i] = Randomizer().state;
+    }
+
+    state = _mm_load_si128((const __m128i *) lanes);
+}
+
+
+/**
+ * @brief Seed one lane
+ * @param lane Lane 0..3
+ * @param seed
+ */
+void RandomizerSSE::seed(int lane, uint32_t seed) {
+    alignas(16) uint32_t lanes[4];
+
+    _mm_store_si128((__m128i *) lanes, state);
+    lanes[lane] = Randomizer(seed).state;
+    state = _mm_load_si128((const __m128i *) lanes);
 }
 
 
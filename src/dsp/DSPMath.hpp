@@ -1,14 +1,19 @@
 #pragma once
 
 #include <cmath>
-#include <random>
-#include "rack.hpp"
-#include "dsp/decimator.hpp"
+#include <cstdint>
+#include <emmintrin.h>
+#include "DSPHost.hpp"
+#include "Pitch.hpp"
 
 using namespace rack;
 
 const static float TWOPI = (float) M_PI * 2;
 
+#define SINE_TABLE_SIZE 4096
+#define SINE_TABLE_FIXED_SHIFT 20   // 32 - log2(SINE_TABLE_SIZE)
+#define SINE_TABLE_FIXED_MASK 0xFFFFFu
+
 
 /**
  * @brief Basic leaky integrator
@@ -53,6 +58,8 @@ private:
     float alpha;
     float y0;
     float fc;
+    int factor;
+    float sr; // sample rate
 
 public:
 
@@ -62,6 +69,7 @@ public:
      * @param factor Oversampling factor
      */
     LP6DBFilter(float fc, int factor) {
+        sr = engineGetSampleRate();
         updateFrequency(fc, factor);
         y0 = 0.f;
     }
@@ -73,6 +81,13 @@ public:
      */
     void updateFrequency(float fc, int factor);
 
+
+    /**
+     * @brief Set sample rate and recompute the coefficient
+     * @param sr
+     */
+    void setSampleRate(float sr);
+
     /**
      * @brief Filter signal
      * @param x Input sample
@@ -83,81 +98,226 @@ public:
 
 
 /**
- * @brief Simple randomizer
+ * @brief Linear interpolated sine table, indexed by phase in cycles (1.0 = 2*PI)
  */
-struct Randomizer {
+struct SineTable {
+    float data[SINE_TABLE_SIZE + 1];
 
-    Randomizer();
+    SineTable();
+
+
+    /**
+     * @brief Lookup sine value, any phase is accepted as long as it fits into an int
+     * @param t Phase in cycles
+     * @return
+     */
+    inline float lookup(float t) const {
+        /* reduce to -1..1 cycles without floorf() and use odd symmetry to keep precision near zero */
+        float a = t - (int) t;
+        float x = fabsf(a) * SINE_TABLE_SIZE;
+        int i = (int) x;
+        float frac = x - i;
+        float y = data[i] + (data[i + 1] - data[i]) * frac;
+
+        return a < 0.f ? -y : y;
+    }
+
+
+    /**
+     * @brief Lookup sine value by fixed-point phase, index and interpolation are taken straight from the bits
+     * @param p Phase, one cycle is 2^32
+     * @return
+     */
+    inline float lookup(uint32_t p) const {
+        uint32_t i = p >> SINE_TABLE_FIXED_SHIFT;
+        float frac = (p & SINE_TABLE_FIXED_MASK) * (1.f / (SINE_TABLE_FIXED_MASK + 1));
 
-    float nextFloat(float start, float stop);
+        return data[i] + (data[i + 1] - data[i]) * frac;
+    }
 };
 
 
+extern const SineTable sineTable;
+
+
 /**
- * @brief Simple oversampling class
+ * @brief Precomputed Dirichlet kernel for one harmonic band, fast path of BLIT()
+ *
+ * Both sines are taken from the interpolated sine table, so no sinf() and no wrapTWOPI()
+ * is needed per sample. As the kernel is 2*PI periodic, the phase may be passed unwrapped.
+ * Max. deviation from the exact kernel is below 5e-7 of the kernel peak for all bands
+ * up to BLIT_HARMONICS, which is in the same range as the sinf() based BLITcore().
  */
-template<int OVERSAMPLE, int CHANNELS>
-struct Oversampler {
-    float y0, y1;
-    float up[OVERSAMPLE];
-    float data[CHANNELS][OVERSAMPLE];
-    Decimator<OVERSAMPLE, OVERSAMPLE> decimator;
-    int factor = OVERSAMPLE;
+struct BLITKernel {
+    float m = 0.5f;  // (N - 1) + 0.5 of current band, in cycles per phase cycle
+    uint32_t m2 = 1; // 2 * m, always odd, for the fixed-point phase
+    int n = -1;      // current harmonics
+
+    /**
+     * @brief Switch to new harmonic band, only recomputes on change
+     * @param n Harmonics
+     */
+    inline void setHarmonics(int n) {
+        if (BLITKernel::n != n) {
+            BLITKernel::n = n;
+            m = (n > 1 ? n - 1 : 0) + 0.5f;
+            m2 = (uint32_t) (2 * (n > 1 ? n - 1 : 0) + 1);
+        }
+    }
 
 
     /**
-     * @brief Constructor
-     * @param factor Oversampling factor
+     * @brief Compute BLIT for the current band
+     * @param phase Phase in radians
+     * @return
      */
-    Oversampler() {
-        y0 = 0;
-        y1 = 0;
+    inline float compute(float phase) const {
+        float t = phase * (1.f / TWOPI);
+        float den = sineTable.lookup(0.5f * t);
+
+        if (den == 0.f) return 1.f;
+
+        return (sineTable.lookup(m * t) / den - 1.f) * 2;
     }
 
 
     /**
-     * @brief Return linear interpolated position
-     * @param point Point in oversampled data
+     * @brief Compute BLIT for the current band with fixed-point phase, exact and without float wrapping
+     * @param phase Phase, one cycle is 2^32
      * @return
      */
-    float interpolate(int point) {
-        return y0 + (point / factor) * (y1 - y0);
+    inline float compute(uint32_t phase) const {
+        /* half angle and m * phase, both as 33 bit phase shifted down by one */
+        float den = sineTable.lookup(phase >> 1);
+
+        if (den == 0.f) return 1.f;
+
+        uint32_t num = (uint32_t) (((uint64_t) m2 * phase) >> 1);
+
+        return (sineTable.lookup(num) / den - 1.f) * 2;
+    }
+};
+
+
+/**
+ * @brief PolyBLEP residual of a step from -1 to 1 at phase 0, two samples wide
+ * @param t Phase in the range of 0..1
+ * @param dt Absolute phase increment per sample
+ * @param idt 1 / dt
+ * @return
+ */
+inline float polyBLEP(float t, float dt, float idt) {
+    if (t < dt) {
+        t *= idt;
+        return t + t - t * t - 1.f;
     }
 
+    if (t > 1.f - dt) {
+        t = (t - 1.f) * idt;
+        return t * t + t + t + 1.f;
+    }
+
+    return 0.f;
+}
+
+
+/**
+ * @brief PolyBLAMP residual of a unit slope change per sample at phase 0, integral of polyBLEP()
+ * @param t Phase in the range of 0..1
+ * @param dt Absolute phase increment per sample
+ * @param idt 1 / dt
+ * @return
+ */
+inline float polyBLAMP(float t, float dt, float idt) {
+    if (t < dt) {
+        t = 1.f - t * idt;
+        return t * t * t * (1.f / 6.f);
+    }
+
+    if (t > 1.f - dt) {
+        t = 1.f + (t - 1.f) * idt;
+        return t * t * t * (1.f / 6.f);
+    }
+
+    return 0.f;
+}
+
+
+/**
+ * @brief Simple per-instance randomizer (xorshift32), holds no shared state and is
+ * therefore safe to be used from any thread
+ */
+struct Randomizer {
+    uint32_t state;
+
+    Randomizer();
+    explicit Randomizer(uint32_t seed);
+
+    void seed(uint32_t seed);
+
 
     /**
-     * @brief Create up-sampled data out of two basic values
+     * @brief Return next raw 32 bit random number
+     * @return
      */
-    void doUpsample() {
-        for (int i = 0; i < factor; i++) {
-            up[i] = interpolate(i + 1);
-        }
+    inline uint32_t next() {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
     }
 
 
     /**
-     * @brief Downsample data from agiven channel
-     * @param channel Channel to proccess
-     * @return Downsampled point
+     * @brief Return next random float in the range of start - stop
+     * @param start Lower bound
+     * @param stop Upper bound
+     * @return Random number
      */
-    float getDownsampled(int channel) {
-        return decimator.process(data[channel]);
+    inline float nextFloat(float start, float stop) {
+        return start + (stop - start) * ((next() >> 8) * (1.f / 16777216.f));
     }
 
+
+    void fill(float *dst, int n, float start, float stop);
+};
+
+
+/**
+ * @brief Four independent randomizers in SSE lanes, a lane seeded with s yields
+ * the same sequence as Randomizer(s)
+ */
+struct RandomizerSSE {
+    __m128i state;
+
+    RandomizerSSE();
+
+    void seed(int lane, uint32_t seed);
+
+
     /**
-     * @brief Step to next sample point
-     * @param y Next sample point
+     * @brief Return next random floats in the range of start - stop
+     * @param start Lower bound
+     * @param stop Upper bound
+     * @return Random numbers for all lanes
      */
-    void doNext(float y) {
-        y0 = y1;
-        y1 = y;
+    inline __m128 nextFloat(float start, float stop) {
+        state = _mm_xor_si128(state, _mm_slli_epi32(state, 13));
+        state = _mm_xor_si128(state, _mm_srli_epi32(state, 17));
+        state = _mm_xor_si128(state, _mm_slli_epi32(state, 5));
+
+        __m128 x = _mm_cvtepi32_ps(_mm_srli_epi32(state, 8));
+
+        return _mm_add_ps(_mm_set1_ps(start), _mm_mul_ps(x, _mm_set1_ps((stop - start) * (1.f / 16777216.f))));
     }
 };
 
 
 float wrapTWOPI(float n);
 
-float getPhaseIncrement(float frq);
+float getPhaseIncrement(float frq, float isr);
+
+uint32_t getPhaseIncrementFixed(float frq, float isr);
 
 float clipl(float in, float clip);
 
@@ -173,6 +333,8 @@ float qsinlp(float x);
 
 float BLIT(float N, float phase);
 
+float BLITcore(float N, float phase);
+
 float shape1(float a, float x);
 
 double saturate(double x, double a);
@@ -217,4 +379,206 @@ inline double saturate2(double input) { //clamp without branching
     double x1 = fabs(input + _limit);
     double x2 = fabs(input - _limit);
     return 0.5 * (x1 - x2);
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Fast tanh approximation (Pade 3/2), exact slope at zero and clipped at +-1
+ * @param x Input sample
+ * @return
+ */
+inline float fastTanh(float x) {
+    if (x < -3.f) return -1.f;
+    if (x > 3.f) return 1.f;
+
+    float x2 = x * x;
+    return x * (27.f + x2) / (27.f + 9.f * x2);
+}
+
+
+/**
+ * @brief Sine of four phases given in cycles (1.0 = 2*PI), odd minimax polynomial after folding to -PI/2..PI/2
+ *
+ * Folding keeps the relative precision around the zero crossings at 0 and PI, as BLIT divides by it.
+ * Max. error is below 2e-7.
+ * @param t Phases in cycles, any value that fits into an int
+ * @return
+ */
+inline __m128 fastSinSSE(__m128 t) {
+    const __m128 sign = _mm_set1_ps(-0.f);
+
+    /* reduce to -0.5..0.5 cycles and mirror the outer quarters, sin(0.5 - r) = sin(r) */
+    __m128 r = _mm_sub_ps(t, _mm_cvtepi32_ps(_mm_cvtps_epi32(t)));
+    __m128 mirrored = _mm_sub_ps(_mm_or_ps(_mm_set1_ps(0.5f), _mm_and_ps(r, sign)), r);
+    __m128 outer = _mm_cmpgt_ps(_mm_andnot_ps(sign, r), _mm_set1_ps(0.25f));
+
+    r = _mm_or_ps(_mm_and_ps(outer, mirrored), _mm_andnot_ps(outer, r));
+
+    __m128 x = _mm_mul_ps(r, _mm_set1_ps(TWOPI));
+    __m128 x2 = _mm_mul_ps(x, x);
+    __m128 y = _mm_set1_ps(2.59049093e-06f);
+
+    y = _mm_add_ps(_mm_mul_ps(y, x2), _mm_set1_ps(-1.98008992e-04f));
+    y = _mm_add_ps(_mm_mul_ps(y, x2), _mm_set1_ps(8.33289985e-03f));
+    y = _mm_add_ps(_mm_mul_ps(y, x2), _mm_set1_ps(-1.66666476e-01f));
+    y = _mm_add_ps(_mm_mul_ps(y, x2), _mm_set1_ps(9.99999977e-01f));
+
+    return _mm_mul_ps(y, x);
+}
+
+
+
+/**
+ * @brief Sine of four fixed-point phases, same polynomial as fastSinSSE(__m128) but folded exactly in integer
+ * @param p Phases, one cycle is 2^32
+ * @return
+ */
+inline __m128 fastSinSSE(__m128i p) {
+    /* as signed this is -0.5..0.5 cycles, mirror the outer quarters with sin(0.5 - r) = sin(r), 2^31 = -2^31 */
+    __m128i outer = _mm_or_si128(_mm_cmpgt_epi32(p, _mm_set1_epi32(0x40000000)),
+                                 _mm_cmplt_epi32(p, _mm_set1_epi32(-0x40000000)));
+    __m128i mirrored = _mm_sub_epi32(_mm_set1_epi32((int32_t) 0x80000000), p);
+    __m128i r = _mm_or_si128(_mm_and_si128(outer, mirrored), _mm_andnot_si128(outer, p));
+
+    __m128 x = _mm_mul_ps(_mm_cvtepi32_ps(r), _mm_set1_ps(TWOPI / 4294967296.f));
+    __m128 x2 = _mm_mul_ps(x, x);
+    __m128 y = _mm_set1_ps(2.59049093e-06f);
+
+    y = _mm_add_ps(_mm_mul_ps(y, x2), _mm_set1_ps(-1.98008992e-04f));
+    y = _mm_add_ps(_mm_mul_ps(y, x2), _mm_set1_ps(8.33289985e-03f));
+    y = _mm_add_ps(_mm_mul_ps(y, x2), _mm_set1_ps(-1.66666476e-01f));
+    y = _mm_add_ps(_mm_mul_ps(y, x2), _mm_set1_ps(9.99999977e-01f));
+
+    return _mm_mul_ps(y, x);
+}
+
+
+/**
+ * @brief Fast natural logarithm, 2 * atanh((m - 1) / (m + 1)) of the mantissa plus the exponent
+ *
+ * The mantissa is folded to sqrt(0.5)..sqrt(2), so four terms of the series give a max. error below 1e-7.
+ * @param x Positive normal number
+ * @return
+ */
+inline float fastLog(float x) {
+    union {
+        float f;
+        int32_t i;
+    } u;
+
+    u.f = x;
+
+    int e = ((u.i >> 23) & 0xFF) - 127;
+    u.i = (u.i & 0x7FFFFF) | 0x3F800000;
+
+    float m = u.f;
+
+    if (m > 1.41421356f) {
+        m *= 0.5f;
+        e++;
+    }
+
+    float t = (m - 1.f) / (m + 1.f);
+    float t2 = t * t;
+
+    return t * (2.f + t2 * (0.666666667f + t2 * (0.4f + t2 * 0.285714286f))) + e * 0.693147181f;
+}
+
+
+/**
+ * @brief Fast natural logarithm of four values, same series as fastLog()
+ * @param x Positive normal numbers
+ * @return
+ */
+inline __m128 fastLogSSE(__m128 x) {
+    __m128i i = _mm_castps_si128(x);
+    __m128i e = _mm_sub_epi32(_mm_srli_epi32(i, 23), _mm_set1_epi32(127));
+    __m128 m = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(i, _mm_set1_epi32(0x7FFFFF)), _mm_set1_epi32(0x3F800000)));
+
+    /* fold the upper half of the mantissa, a true compare is -1 and increments the exponent */
+    __m128 upper = _mm_cmpgt_ps(m, _mm_set1_ps(1.41421356f));
+
+    m = _mm_or_ps(_mm_and_ps(upper, _mm_mul_ps(m, _mm_set1_ps(0.5f))), _mm_andnot_ps(upper, m));
+    e = _mm_sub_epi32(e, _mm_castps_si128(upper));
+
+    __m128 t = _mm_div_ps(_mm_sub_ps(m, _mm_set1_ps(1.f)), _mm_add_ps(m, _mm_set1_ps(1.f)));
+    __m128 t2 = _mm_mul_ps(t, t);
+    __m128 p = _mm_add_ps(_mm_set1_ps(0.4f), _mm_mul_ps(t2, _mm_set1_ps(0.285714286f)));
+
+    p = _mm_add_ps(_mm_set1_ps(0.666666667f), _mm_mul_ps(t2, p));
+    p = _mm_add_ps(_mm_set1_ps(2.f), _mm_mul_ps(t2, p));
+
+    return _mm_add_ps(_mm_mul_ps(t, p), _mm_mul_ps(_mm_cvtepi32_ps(e), _mm_set1_ps(0.693147181f)));
+}
+
+
+/**
+ * @brief Fast arc tangent, range reduction to -tan(PI/8)..tan(PI/8) and odd polynomial, max. error 2e-7
+ * @param x
+ * @return
+ */
+inline float fastAtan(float x) {
+    float sign = x < 0.f ? -1.f : 1.f;
+    float y = 0.f;
+
+    x = fabsf(x);
+
+    if (x > 2.41421356f) {
+        y = (float) M_PI_2;
+        x = -1.f / x;
+    } else if (x > 0.414213562f) {
+        y = (float) M_PI_4;
+        x = (x - 1.f) / (x + 1.f);
+    }
+
+    float z = x * x;
+
+    y += (((8.05374449538e-2f * z - 1.38776856032e-1f) * z + 1.99777106478e-1f) * z - 3.33329491539e-1f) * z * x + x;
+
+    return y * sign;
+}
+
+
+/**
+ * @brief Fast arc tangent of four values, same reduction and polynomial as fastAtan()
+ * @param x
+ * @return
+ */
+inline __m128 fastAtanSSE(__m128 x) {
+    const __m128 sign = _mm_set1_ps(-0.f);
+    const __m128 one = _mm_set1_ps(1.f);
+
+    __m128 s = _mm_and_ps(x, sign);
+    __m128 a = _mm_andnot_ps(sign, x);
+
+    /* reduction of the three ranges, the outer ones overlap and the upper one wins */
+    __m128 upper = _mm_cmpgt_ps(a, _mm_set1_ps(2.41421356f));
+    __m128 middle = _mm_andnot_ps(upper, _mm_cmpgt_ps(a, _mm_set1_ps(0.414213562f)));
+
+    __m128 r = _mm_or_ps(_mm_and_ps(upper, _mm_div_ps(_mm_set1_ps(-1.f), a)),
+                         _mm_or_ps(_mm_and_ps(middle, _mm_div_ps(_mm_sub_ps(a, one), _mm_add_ps(a, one))),
+                                   _mm_andnot_ps(_mm_or_ps(upper, middle), a)));
+    __m128 y = _mm_or_ps(_mm_and_ps(upper, _mm_set1_ps((float) M_PI_2)), _mm_and_ps(middle, _mm_set1_ps((float) M_PI_4)));
+
+    __m128 z = _mm_mul_ps(r, r);
+    __m128 p = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(8.05374449538e-2f), z), _mm_set1_ps(-1.38776856032e-1f));
+
+    p = _mm_add_ps(_mm_mul_ps(p, z), _mm_set1_ps(1.99777106478e-1f));
+    p = _mm_add_ps(_mm_mul_ps(p, z), _mm_set1_ps(-3.33329491539e-1f));
+
+    y = _mm_add_ps(y, _mm_add_ps(_mm_mul_ps(_mm_mul_ps(p, z), r), r));
+
+    return _mm_or_ps(y, s);
+}
+
+
+/**
+ * @brief Fast reciprocal of four values, the 12 bit estimate of rcpps refined by one Newton step to ~22 bit
+ * @param d Non-zero values
+ * @return
+ */
+inline __m128 fastRcpSSE(__m128 d) {
+    __m128 r = _mm_rcp_ps(d);
+
+    /* r (2 - d r), doubles the number of correct bits */
+    return _mm_sub_ps(_mm_add_ps(r, r), _mm_mul_ps(d, _mm_mul_ps(r, r)));
+}
@@ -6,13 +6,46 @@ using namespace rack;
 /**
  * @brief Constructor
  */
-LadderFilter::LadderFilter() {}
+LadderFilter::LadderFilter() {
+    f = p = q = 0.f;
+    fz = pz = qz = 0.f;
+    df = dp = dq = 0.f;
+    b0 = b1 = b2 = b3 = b4 = 0.f;
+    t1 = t2 = 0.f;
+    freqExp = frequency = resExp = resonance = drive = 0.f;
+    freqHz = cutoffToHz(frequency);
+    in = lpOut = bpOut = hpOut = 0.f;
+
+    controlRate = controlCount = 0;
+    dirty = false;
+
+    updateFreqExp();
+    updateResExp();
+    invalidate();
+
+    fz = f;
+    pz = p;
+    qz = q;
+}
 
 
 /**
  * @brief Check parameter
  */
 void LadderFilter::invalidate() {
+    computeCoefficients(freqExp, resExp, p, q, f);
+}
+
+
+/**
+ * @brief Compute filter coefficients, shared with LadderFilterBank
+ * @param freqExp Cutoff relative to the oversampled nyquist frequency [0.0...1.0]
+ * @param resExp Resonance
+ * @param p
+ * @param q
+ * @param f
+ */
+void LadderFilter::computeCoefficients(float freqExp, float resExp, float &p, float &q, float &f) {
     // Set coefficients given frequency & resonance [0.0...1.0]
     q = 1.0f - freqExp;
     p = freqExp + 0.8f * freqExp * q;
@@ -21,44 +54,211 @@ void LadderFilter::invalidate() {
 }
 
 
+/**
+ * @brief Translate cutoff frequency to the oversampled nyquist frequency
+ * @param freqHz Cutoff frequency in Hz
+ * @param factor Oversampling factor
+ * @param isr 1 / sample rate
+ * @return
+ */
+float LadderFilter::computeFreqExp(float freqHz, int factor, float isr) {
+    return clampf(freqHz * (2.f * isr / factor), 0.f, 1.f);
+}
+
+
+/**
+ * @brief Compute non-linear resonance factor
+ * @param resonance
+ * @param drive
+ * @return
+ */
+float LadderFilter::computeResExp(float resonance, float drive) {
+    float resExp = clampf(resonance, 0, 1.5f);
+    resExp = resExp * (1 - (drive / 3));
+    // add some curve to resonance to avoid aliasing at high frequency
+    // resExp *= (-0.50 * frequency + 1.1);
+    return resExp;
+}
+
+
 /**
  * @brief Calculate new sample
  * @return
  */
 void LadderFilter::process() {
-    os.doNext(in);
-    os.doUpsample();
-
-    for (int i = 0; i < os.factor; i++) {
-        in = os.up[i];
+    process(&in, nullptr, &hpOut, &bpOut, 1);
+}
 
-        in -= q * b4;
 
-        t1 = b1;
-        b1 = (in + b0) * p - b1 * f;
+/**
+ * @brief Process a block of samples, coefficient changes are ramped linear over the block or the control rate
+ * @param in Input buffer
+ * @param lp Lowpass output buffer (overdriven like getLpOut()), may be nullptr
+ * @param hp Highpass output buffer, may be nullptr
+ * @param bp Bandpass output buffer, may be nullptr
+ * @param n Number of samples
+ */
+void LadderFilter::process(const float *in, float *lp, float *hp, float *bp, int n) {
+    process(in, nullptr, lp, hp, bp, n);
+}
 
-        t2 = b2;
-        b2 = (b1 + t1) * p - b2 * f;
 
-        t1 = b3;
-        b3 = (b2 + t2) * p - b3 * f;
+/**
+ * @brief Process a block of samples with audio rate cutoff modulation
+ * @param in Input buffer
+ * @param cutoff Cutoff for every sample in the range of 0..1 like setFrequency(), nullptr to use setFrequency()
+ * @param lp Lowpass output buffer (overdriven like getLpOut()), may be nullptr
+ * @param hp Highpass output buffer, may be nullptr
+ * @param bp Bandpass output buffer, may be nullptr
+ * @param n Number of samples
+ */
+void LadderFilter::process(const float *in, const float *cutoff, float *lp, float *hp, float *bp, int n) {
+    if (n <= 0) return;
+
+    switch (os.factor) {
+        case 2:
+            processBlock<2>(in, cutoff, lp, hp, bp, n);
+            break;
+        case 4:
+            processBlock<4>(in, cutoff, lp, hp, bp, n);
+            break;
+        case 16:
+            processBlock<16>(in, cutoff, lp, hp, bp, n);
+            break;
+        default:
+            processBlock<8>(in, cutoff, lp, hp, bp, n);
+    }
+}
 
-        b4 = (b3 + t1) * p - b4 * f;
 
-        b4 = clampf(b4 - b4 * b4 * b4 * b4 * b4 * 4, -1, 1) + rnd.nextFloat(-10e-8f, +10e-8f);
-        //  b4 = lpf.filter(tanh(b4)) + rnd.nextFloat(-10e-8f, +10e-8f);
-        //  b4 = (b4 - quadraticBipolar(b4)*0.1) + rnd.nextFloat(-10e-8f, +10e-8f);
-        b0 = in;
+/**
+ * @brief Start a new coefficient ramp, recomputes the targets if a parameter changed
+ * @param steps Length of the ramp in samples
+ */
+void LadderFilter::updateRamp(int steps) {
+    if (dirty) {
+        updateFreqExp();
+        updateResExp();
+        invalidate();
 
-        os.data[LP_CHANNEL][i] = b4;
-        os.data[HP_CHANNEL][i] = ((b3 - b4) * 60.0f);
-        os.data[BP_CHANNEL][i] = (((in - 3.0f * (b3 - b4)) - b4) * 15.0f);
+        dirty = false;
     }
 
-    lpOut = os.getDownsampled(LP_CHANNEL);
-    hpOut = os.getDownsampled(HP_CHANNEL);
-    bpOut = os.getDownsampled(BP_CHANNEL);
+    dp = (p - pz) / steps;
+    dq = (q - qz) / steps;
+    df = (f - fz) / steps;
+
+    controlCount = steps;
+}
+
+
+/**
+ * @brief Block processing with fixed oversampling factor, the filter state is kept in locals
+ * @param in Input buffer
+ * @param cutoff Cutoff for every sample, may be nullptr
+ * @param lp Lowpass output buffer, may be nullptr
+ * @param hp Highpass output buffer, may be nullptr
+ * @param bp Bandpass output buffer, may be nullptr
+ * @param n Number of samples
+ */
+template<int FACTOR>
+void LadderFilter::processBlock(const float *in, const float *cutoff, float *lp, float *hp, float *bp, int n) {
+    float noise[FACTOR];
+
+    /* n == 0 writes back the state unchanged */
+    float z0 = b0, z1 = b1, z2 = b2, z3 = b3, z4 = b4;
+    float x = LadderFilter::in, s1 = t1, s2 = t2;
+
+    /* in block mode the ramp always ends with the block */
+    if (controlRate <= 0) controlCount = 0;
+
+    /* output overdrive, constant for the block */
+    float d = quadraticBipolar(drive) * 50 + 1;
+    float gain = 1 / (drive * 3 + 1);
+
+    float toNyquist = 2.f * isr / FACTOR;
+    float cp = pz, cq = qz, cf = fz;
+
+    for (int k = 0; k < n; k++) {
+        if (controlCount <= 0) {
+            updateRamp(controlRate > 0 ? controlRate : n - k);
+        }
+
+        /* the last sample of a ramp hits the target exactly */
+        if (--controlCount > 0) {
+            pz += dp;
+            qz += dq;
+            fz += df;
+        } else {
+            pz = p;
+            qz = q;
+            fz = f;
+        }
+
+        cp = pz;
+        cq = qz;
+        cf = fz;
+
+        if (cutoff) {
+            /* audio rate cutoff, exponential mapping without powf() */
+            float fe = clampf(cutoffToHz(cutoff[k]) * toNyquist, 0.f, 1.f);
+            computeCoefficients(fe, resExp, cp, cq, cf);
+        }
+
+        os.template upsample<FACTOR>(in[k]);
+
+        /* dither for the nonlinearity, generated in one block */
+        rnd.fill(noise, FACTOR, -10e-8f, +10e-8f);
+
+        for (int i = 0; i < FACTOR; i++) {
+            x = os.up[i] - cq * z4;
+
+            s1 = z1;
+            z1 = (x + z0) * cp - z1 * cf;
+
+            s2 = z2;
+            z2 = (z1 + s1) * cp - z2 * cf;
 
+            s1 = z3;
+            z3 = (z2 + s2) * cp - z3 * cf;
+
+            z4 = (z3 + s1) * cp - z4 * cf;
+
+            z4 = clampf(z4 - z4 * z4 * z4 * z4 * z4 * 4, -1, 1) + noise[i];
+            z0 = x;
+
+            os.data[i][LP_CHANNEL] = z4;
+            os.data[i][HP_CHANNEL] = ((z3 - z4) * 60.0f);
+            os.data[i][BP_CHANNEL] = (((x - 3.0f * (z3 - z4)) - z4) * 15.0f);
+        }
+
+        os.template downsample<FACTOR>();
+
+        lpOut = os.getDownsampled(LP_CHANNEL);
+
+        if (lp) lp[k] = lpOut * (fabsf(lpOut) + d) / (lpOut * lpOut + (d - 1) * fabsf(lpOut) + 1) * gain;
+        if (hp) hp[k] = os.getDownsampled(HP_CHANNEL);
+        if (bp) bp[k] = os.getDownsampled(BP_CHANNEL);
+    }
+
+    /* write back state */
+    b0 = z0;
+    b1 = z1;
+    b2 = z2;
+    b3 = z3;
+    b4 = z4;
+    t1 = s1;
+    t2 = s2;
+    LadderFilter::in = x;
+
+    if (cutoff) {
+        /* continue from the modulated coefficients, the next ramp heads back to setFrequency() */
+        controlCount = 0;
+
+        pz = cp;
+        qz = cq;
+        fz = cf;
+    }
 }
 
 
@@ -72,30 +272,41 @@ float LadderFilter::getFrequency() const {
 
 
 /**
- * @brief Update cutoff frequency in the range of 0..1
+ * @brief Update cutoff frequency in the range of 0..1, coefficients follow at the next control step
  * @param frequency
  */
 void LadderFilter::setFrequency(float frequency) {
     if (LadderFilter::frequency != frequency) {
         LadderFilter::frequency = frequency;
-        // translate frequency to logarithmic scale
-        freqHz = 20.f * powf(1000.f, frequency);
-        freqExp = clampf(freqHz * (1.f / (engineGetSampleRate() * 8 / 2.f)), 0.f, 1.f);
-
-        updateResExp();
-        invalidate();
+        // translate frequency to logarithmic scale, getFreqHz() follows right away
+        freqHz = cutoffToHz(frequency);
+        dirty = true;
     }
 }
 
 
+/**
+ * @brief Translate cutoff to the oversampled rate
+ */
+void LadderFilter::updateFreqExp() {
+    freqExp = computeFreqExp(freqHz, os.factor, isr);
+}
+
+
+/**
+ * @brief Recompute the coefficients for the new sample rate right away, the ramp continues from the old ones
+ */
+void LadderFilter::onSampleRateChange() {
+    updateFreqExp();
+    invalidate();
+}
+
+
 /**
  * @brief Update non-linear resonance factor
  */
 void LadderFilter::updateResExp() {
-    resExp = clampf(resonance, 0, 1.5f);
-    resExp = resExp * (1 - (drive / 3));
-    // add some curve to resonance to avoid aliasing at high frequency
-    // resExp *= (-0.50 * frequency + 1.1);
+    resExp = computeResExp(resonance, drive);
 }
 
 
@@ -115,9 +326,7 @@ float LadderFilter::getResonance() const {
 void LadderFilter::setResonance(float resonance) {
     if (LadderFilter::resonance != resonance) {
         LadderFilter::resonance = resonance;
-
-        updateResExp();
-        invalidate();
+        dirty = true;
     }
 }
 
@@ -138,9 +347,7 @@ float LadderFilter::getDrive() const {
 void LadderFilter::setDrive(float drive) {
     if (LadderFilter::drive != drive) {
         LadderFilter::drive = drive;
-
-        updateResExp();
-        invalidate();
+        dirty = true;
     }
 }
 
@@ -162,7 +369,7 @@ float LadderFilter::getLpOut() {
     float out;// = clip(lpOut * (drive * 20 + 1), 0.7, -0.7) * (1/(drive+1)*12);
     float d = quadraticBipolar(drive) * 50 + 1;
 
-    out = lpOut * (abs(lpOut) + d) / (lpOut * lpOut + (d - 1) * abs(lpOut) + 1);
+    out = lpOut * (fabsf(lpOut) + d) / (lpOut * lpOut + (d - 1) * fabsf(lpOut) + 1);
 
     return out * 1 / (drive * 3 + 1);
 }
@@ -194,3 +401,51 @@ float LadderFilter::getHpOut() const {
     return hpOut;
 }
 
+
+/**
+ * @brief Get oversampling factor
+ * @return
+ */
+int LadderFilter::getOversampling() const {
+    return os.factor;
+}
+
+
+/**
+ * @brief Set oversampling factor, trades CPU against aliasing
+ * @param factor 2, 4, 8 or 16
+ */
+void LadderFilter::setOversampling(int factor) {
+    if (os.factor != factor) {
+        os.setFactor(factor);
+        dirty = true;
+    }
+}
+
+
+/**
+ * @brief Get control rate
+ * @return Samples between coefficient updates, 0 if updated once per processed block
+ */
+int LadderFilter::getControlRate() const {
+    return controlRate;
+}
+
+
+/**
+ * @brief Compute coefficients only every n samples and interpolate in between, cheap under audio rate modulation
+ * @param samples Samples between coefficient updates, e.g. 16 or 32. 0 updates once per processed block
+ */
+void LadderFilter::setControlRate(int samples) {
+    controlRate = samples > 0 ? samples : 0;
+    controlCount = 0;
+}
+
+
+/**
+ * @brief Seed the dither noise, for reproducible renders
+ * @param seed
+ */
+void LadderFilter::setSeed(uint32_t seed) {
+    rnd.seed(seed);
+}
@@ -2,8 +2,9 @@
 
 
 #include "DSPEffect.hpp"
-#include "engine.hpp"
+#include "DSPHost.hpp"
 #include "DSPMath.hpp"
+#include "Oversampler.hpp"
 
 #define LP_CHANNEL 0
 #define HP_CHANNEL 1
@@ -14,22 +15,36 @@ namespace rack {
     struct LadderFilter : DSPEffect {
     private:
         float f, p, q;
+        float fz, pz, qz;
+        float df, dp, dq;
         float b0, b1, b2, b3, b4;
         float t1, t2;
         float freqExp, freqHz, frequency, resExp, resonance, drive;
         float in, lpOut, bpOut, hpOut;
 
-        Oversampler<8, 3> os;
+        Oversampler<3> os;
         Randomizer rnd;
 
+        /* samples between coefficient updates (0 = once per processed block) and samples left in the current ramp */
+        int controlRate, controlCount;
+        bool dirty;
+
+        void updateFreqExp();
         void updateResExp();
+        void updateRamp(int steps);
+
+        template<int FACTOR>
+        void processBlock(const float *in, const float *cutoff, float *lp, float *hp, float *bp, int n);
 
     public:
         LadderFilter();
 
         void invalidate() override;
+        void onSampleRateChange() override;
 
         void process() override;
+        void process(const float *in, float *lp, float *hp, float *bp, int n);
+        void process(const float *in, const float *cutoff, float *lp, float *hp, float *bp, int n);
 
         float getFrequency() const;
         void setFrequency(float frequency);
@@ -38,6 +53,15 @@ namespace rack {
         float getDrive() const;
         void setDrive(float drive);
         float getFreqHz() const;
+        int getOversampling() const;
+        void setOversampling(int factor);
+        int getControlRate() const;
+        void setControlRate(int samples);
+        void setSeed(uint32_t seed);
+
+        static float computeFreqExp(float freqHz, int factor, float isr);
+        static float computeResExp(float resonance, float drive);
+        static void computeCoefficients(float freqExp, float resExp, float &p, float &q, float &f);
 
         void setIn(float in);
         float getLpOut();
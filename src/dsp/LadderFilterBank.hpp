@@ -0,0 +1,299 @@
+#pragma once
+
+#include "LadderFilter.hpp"
+
+namespace rack {
+
+    /**
+     * @brief Polyphonic version of LadderFilter, processes 4 voices per SSE instruction
+     *
+     * All state is kept as structure-of-arrays with one voice per lane, so every voice behaves like
+     * a single LadderFilter with the same parameters and seed. The oversampling factor is shared.
+     */
+    template<int VOICES>
+    struct LadderFilterBank : DSPEffect {
+        static_assert(VOICES % 4 == 0, "LadderFilterBank needs a multiple of 4 voices");
+        static const int GROUPS = VOICES / 4;
+
+    private:
+        /* per voice parameters */
+        float frequency[VOICES], resonance[VOICES], drive[VOICES];
+        float freqHz[VOICES], freqExp[VOICES], resExp[VOICES];
+
+        /* per voice coefficients, loaded into lanes while processing */
+        alignas(16) float p[VOICES], q[VOICES], f[VOICES];
+        alignas(16) float d[VOICES], gain[VOICES];
+
+        /* signal in- and outputs */
+        alignas(16) float in[VOICES], lpOut[VOICES], hpOut[VOICES], bpOut[VOICES];
+
+        /* filter state */
+        __m128 b0[GROUPS], b1[GROUPS], b2[GROUPS], b3[GROUPS], b4[GROUPS];
+
+        InterpolatorSSE interpolator[GROUPS];
+        DecimatorSSE decimator[3][GROUPS];
+        RandomizerSSE rnd[GROUPS];
+        int factor = 8;
+
+
+        /**
+         * @brief Recompute the coefficients of one voice
+         * @param voice
+         */
+        void invalidate(int voice) {
+            freqExp[voice] = LadderFilter::computeFreqExp(freqHz[voice], factor, isr);
+            resExp[voice] = LadderFilter::computeResExp(resonance[voice], drive[voice]);
+
+            LadderFilter::computeCoefficients(freqExp[voice], resExp[voice], p[voice], q[voice], f[voice]);
+
+            d[voice] = quadraticBipolar(drive[voice]) * 50 + 1;
+            gain[voice] = 1 / (drive[voice] * 3 + 1);
+        }
+
+
+        /**
+         * @brief Process one sample of all voices with fixed oversampling factor
+         */
+        template<int FACTOR>
+        void processFactor() {
+            __m128 up[GROUPS][FACTOR];
+            __m128 lp[GROUPS][FACTOR], hp[GROUPS][FACTOR], bp[GROUPS][FACTOR];
+
+            const __m128 one = _mm_set1_ps(1.f);
+            const __m128 minusOne = _mm_set1_ps(-1.f);
+            const __m128 four = _mm_set1_ps(4.f);
+            const __m128 three = _mm_set1_ps(3.f);
+            const __m128 sixty = _mm_set1_ps(60.f);
+            const __m128 fifteen = _mm_set1_ps(15.f);
+            const __m128 sign = _mm_set1_ps(-0.f);
+
+            for (int g = 0; g < GROUPS; g++) {
+                interpolator[g].template process<FACTOR>(_mm_load_ps(in + 4 * g), up[g]);
+            }
+
+            __m128 cp[GROUPS], cq[GROUPS], cf[GROUPS];
+            __m128 z0[GROUPS], z1[GROUPS], z2[GROUPS], z3[GROUPS], z4[GROUPS];
+
+            for (int g = 0; g < GROUPS; g++) {
+                cp[g] = _mm_load_ps(p + 4 * g);
+                cq[g] = _mm_load_ps(q + 4 * g);
+                cf[g] = _mm_load_ps(f + 4 * g);
+
+                z0[g] = b0[g];
+                z1[g] = b1[g];
+                z2[g] = b2[g];
+                z3[g] = b3[g];
+                z4[g] = b4[g];
+            }
+
+            for (int i = 0; i < FACTOR; i++) {
+                /* the groups are independent, interleaving them hides the latency of the recursion */
+                for (int g = 0; g < GROUPS; g++) {
+                    __m128 x = _mm_sub_ps(up[g][i], _mm_mul_ps(cq[g], z4[g]));
+                    __m128 s1, s2, t;
+
+                    s1 = z1[g];
+                    z1[g] = _mm_sub_ps(_mm_mul_ps(_mm_add_ps(x, z0[g]), cp[g]), _mm_mul_ps(z1[g], cf[g]));
+
+                    s2 = z2[g];
+                    z2[g] = _mm_sub_ps(_mm_mul_ps(_mm_add_ps(z1[g], s1), cp[g]), _mm_mul_ps(z2[g], cf[g]));
+
+                    s1 = z3[g];
+                    z3[g] = _mm_sub_ps(_mm_mul_ps(_mm_add_ps(z2[g], s2), cp[g]), _mm_mul_ps(z3[g], cf[g]));
+
+                    z4[g] = _mm_sub_ps(_mm_mul_ps(_mm_add_ps(z3[g], s1), cp[g]), _mm_mul_ps(z4[g], cf[g]));
+
+                    /* clampf(z4 - z4^5 * 4, -1, 1) + dither */
+                    t = _mm_mul_ps(z4[g], z4[g]);
+                    t = _mm_mul_ps(t, z4[g]);
+                    t = _mm_mul_ps(t, z4[g]);
+                    t = _mm_mul_ps(t, z4[g]);
+                    t = _mm_sub_ps(z4[g], _mm_mul_ps(t, four));
+                    t = _mm_min_ps(_mm_max_ps(t, minusOne), one);
+                    z4[g] = _mm_add_ps(t, rnd[g].nextFloat(-10e-8f, +10e-8f));
+                    z0[g] = x;
+
+                    lp[g][i] = z4[g];
+                    hp[g][i] = _mm_mul_ps(_mm_sub_ps(z3[g], z4[g]), sixty);
+                    bp[g][i] = _mm_mul_ps(_mm_sub_ps(_mm_sub_ps(x, _mm_mul_ps(three, _mm_sub_ps(z3[g], z4[g]))), z4[g]), fifteen);
+                }
+            }
+
+            for (int g = 0; g < GROUPS; g++) {
+                b0[g] = z0[g];
+                b1[g] = z1[g];
+                b2[g] = z2[g];
+                b3[g] = z3[g];
+                b4[g] = z4[g];
+            }
+
+            for (int g = 0; g < GROUPS; g++) {
+                __m128 l = decimator[LP_CHANNEL][g].template process<FACTOR>(lp[g]);
+                __m128 h = decimator[HP_CHANNEL][g].template process<FACTOR>(hp[g]);
+                __m128 b = decimator[BP_CHANNEL][g].template process<FACTOR>(bp[g]);
+
+                /* output overdrive, see LadderFilter::getLpOut() */
+                __m128 dv = _mm_load_ps(d + 4 * g);
+                __m128 a = _mm_andnot_ps(sign, l);
+                __m128 num = _mm_mul_ps(l, _mm_add_ps(a, dv));
+                __m128 den = _mm_add_ps(_mm_add_ps(_mm_mul_ps(l, l), _mm_mul_ps(_mm_sub_ps(dv, one), a)), one);
+
+                _mm_store_ps(lpOut + 4 * g, _mm_mul_ps(_mm_div_ps(num, den), _mm_load_ps(gain + 4 * g)));
+                _mm_store_ps(hpOut + 4 * g, h);
+                _mm_store_ps(bpOut + 4 * g, b);
+            }
+        }
+
+    public:
+
+        LadderFilterBank() {
+            for (int i = 0; i < VOICES; i++) {
+                frequency[i] = resonance[i] = drive[i] = 0.f;
+                freqHz[i] = 20.f;
+                in[i] = lpOut[i] = hpOut[i] = bpOut[i] = 0.f;
+
+                invalidate(i);
+            }
+
+            for (int g = 0; g < GROUPS; g++) {
+                b0[g] = b1[g] = b2[g] = b3[g] = b4[g] = _mm_setzero_ps();
+            }
+        }
+
+
+        /**
+         * @brief Recompute coefficients of all voices
+         */
+        void invalidate() override {
+            for (int i = 0; i < VOICES; i++) {
+                invalidate(i);
+            }
+        }
+
+
+        /**
+         * @brief Process one sample of all voices
+         */
+        void process() override {
+            switch (factor) {
+                case 2:
+                    processFactor<2>();
+                    break;
+                case 4:
+                    processFactor<4>();
+                    break;
+                case 16:
+                    processFactor<16>();
+                    break;
+                default:
+                    processFactor<8>();
+            }
+        }
+
+
+        /**
+         * @brief Update cutoff frequency of a voice in the range of 0..1
+         * @param voice
+         * @param frequency
+         */
+        void setFrequency(int voice, float frequency) {
+            if (LadderFilterBank::frequency[voice] != frequency) {
+                LadderFilterBank::frequency[voice] = frequency;
+                // translate frequency to logarithmic scale
+                freqHz[voice] = cutoffToHz(frequency);
+
+                invalidate(voice);
+            }
+        }
+
+
+        /**
+         * @brief Set resonance of a voice
+         * @param voice
+         * @param resonance
+         */
+        void setResonance(int voice, float resonance) {
+            if (LadderFilterBank::resonance[voice] != resonance) {
+                LadderFilterBank::resonance[voice] = resonance;
+
+                invalidate(voice);
+            }
+        }
+
+
+        /**
+         * @brief Set overdrive of a voice
+         * @param voice
+         * @param drive
+         */
+        void setDrive(int voice, float drive) {
+            if (LadderFilterBank::drive[voice] != drive) {
+                LadderFilterBank::drive[voice] = drive;
+
+                invalidate(voice);
+            }
+        }
+
+
+        /**
+         * @brief Set oversampling factor of all voices
+         * @param factor 2, 4, 8 or 16
+         */
+        void setOversampling(int factor) {
+            if (factor != 2 && factor != 4 && factor != 8 && factor != 16) factor = 8;
+
+            if (LadderFilterBank::factor != factor) {
+                LadderFilterBank::factor = factor;
+
+                for (int g = 0; g < GROUPS; g++) {
+                    interpolator[g].reset();
+                    decimator[LP_CHANNEL][g].reset();
+                    decimator[HP_CHANNEL][g].reset();
+                    decimator[BP_CHANNEL][g].reset();
+                }
+
+                invalidate();
+            }
+        }
+
+
+        /**
+         * @brief Seed the dither noise of a voice, equal seeds give equal noise as LadderFilter::setSeed()
+         * @param voice
+         * @param seed
+         */
+        void setSeed(int voice, uint32_t seed) {
+            rnd[voice / 4].seed(voice % 4, seed);
+        }
+
+
+        int getOversampling() const {
+            return factor;
+        }
+
+
+        float getFreqHz(int voice) const {
+            return freqHz[voice];
+        }
+
+
+        void setIn(int voice, float in) {
+            LadderFilterBank::in[voice] = in;
+        }
+
+
+        float getLpOut(int voice) const {
+            return lpOut[voice];
+        }
+
+
+        float getHpOut(int voice) const {
+            return hpOut[voice];
+        }
+
+
+        float getBpOut(int voice) const {
+            return bpOut[voice];
+        }
+    };
+}
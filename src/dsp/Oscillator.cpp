@@ -12,6 +12,12 @@ void BLITOscillator::reset() {
     pw = 1.f;
     phase = 0.f;
     incr = 0.f;
+    phaseFixed = 0;
+    incrFixed = 0;
+    fixedPhase = false;
+    fmHz = 0.f;
+    fmMode = FM_MODE_LINEAR;
+    waveMask = OSC_WAVE_ALL;
     saturate = 1.f;
     detune = rand.nextFloat(-0.281273f, 0.2912846f);
     drift = 0.f;
@@ -28,13 +34,7 @@ void BLITOscillator::reset() {
     saturate = 1.f;
     n = 0;
 
-    _cv = 0.f;
-    _oct = 0.f;
-
-    _base = 1.f;
-    _coeff = 1.f;
-    _tune = 0.f;
-    _biqufm = 0.f;
+    pitch = PitchCache();
 
     /* force recalculation of variables */
     setFrequency(NOTE_C4);
@@ -45,6 +45,9 @@ void BLITOscillator::reset() {
  * @brief Default constructor
  */
 BLITOscillator::BLITOscillator() {
+    sr = engineGetSampleRate();
+    isr = 1.f / sr;
+
     reset();
 }
 
@@ -55,6 +58,39 @@ BLITOscillator::BLITOscillator() {
 BLITOscillator::~BLITOscillator() {}
 
 
+/**
+ * @brief Get sample rate
+ * @return
+ */
+float BLITOscillator::getSampleRate() const {
+    return sr;
+}
+
+
+/**
+ * @brief Set sample rate, recomputes all increments on change
+ * @param sr
+ */
+void BLITOscillator::setSampleRate(float sr) {
+    if (BLITOscillator::sr != sr) {
+        BLITOscillator::sr = sr;
+        isr = 1.f / sr;
+
+        invalidate();
+    }
+}
+
+
+/**
+ * @brief Seed the analogue detune, for reproducible renders
+ * @param seed
+ */
+void BLITOscillator::setSeed(uint32_t seed) {
+    rand.seed(seed);
+    detune = rand.nextFloat(-0.281273f, 0.2912846f);
+}
+
+
 /**
  * @brief Get current frequency
  * @return
@@ -64,6 +100,15 @@ float BLITOscillator::getFrequency() const {
 }
 
 
+/**
+ * @brief Get frequency of the last updatePitch() without analogue detune and FM
+ * @return
+ */
+float BLITOscillator::getPitch() const {
+    return pitch.freq;
+}
+
+
 /**
  * @brief Set frequency
  * @param freq
@@ -104,9 +149,76 @@ void BLITOscillator::setPulseWidth(float pw) {
     }
 
     BLITOscillator::pw = pw;
+}
 
-    /* force recalculation of variables */
-    invalidate();
+
+/**
+ * @brief Check for fixed-point phase accumulator
+ * @return
+ */
+bool BLITOscillator::isFixedPhase() const {
+    return fixedPhase;
+}
+
+
+/**
+ * @brief Switch between float and fixed-point phase accumulator, the current phase is kept
+ * @param fixedPhase
+ */
+void BLITOscillator::setFixedPhase(bool fixedPhase) {
+    if (BLITOscillator::fixedPhase == fixedPhase) return;
+
+    if (fixedPhase) {
+        phaseFixed = (uint32_t) (int64_t) (phase * (2147483648.f / (float) M_PI));
+    } else {
+        phase = (int32_t) phaseFixed * ((float) M_PI / 2147483648.f);
+    }
+
+    BLITOscillator::fixedPhase = fixedPhase;
+}
+
+
+/**
+ * @brief Get FM mode
+ * @return FM_MODE_LINEAR or FM_MODE_THROUGH_ZERO
+ */
+int BLITOscillator::getFMMode() const {
+    return fmMode;
+}
+
+
+/**
+ * @brief Set FM mode, through-zero lets the modulated frequency go negative and run the phase backwards
+ * @param fmMode FM_MODE_LINEAR or FM_MODE_THROUGH_ZERO
+ */
+void BLITOscillator::setFMMode(int fmMode) {
+    if (BLITOscillator::fmMode != fmMode) {
+        BLITOscillator::fmMode = fmMode;
+
+        /* force recalculation of variables */
+        invalidate();
+    }
+}
+
+
+/**
+ * @brief Get waveforms computed by proccess()
+ * @return
+ */
+int BLITOscillator::getWaveMask() const {
+    return waveMask;
+}
+
+
+/**
+ * @brief Compute only the requested waveforms, the others keep their last value
+ *
+ * Integrators of waveforms not requested stand still, so a newly requested waveform settles within a few
+ * milliseconds.
+ * @param waveMask Combination of OSC_WAVE_* flags
+ */
+void BLITOscillator::setWaveMask(int waveMask) {
+    BLITOscillator::waveMask = waveMask;
 }
 
 
@@ -159,37 +271,70 @@ float BLITOscillator::getTriangleWave() const {
  * @brief Process band-limited oscillator
  */
 void BLITOscillator::proccess() {
-    /* phase locked loop */
-    phase = wrapTWOPI(incr + phase);
+    float blit1 = 0.f, blit2 = 0.f;
+
+    /* saw and ramp need the first integrator, pulse the second and sawtri and triangle all three */
+    bool first = waveMask != 0;
+    bool second = (waveMask & (OSC_WAVE_PULSE | OSC_WAVE_SAWTRI | OSC_WAVE_TRI)) != 0;
+    bool third = (waveMask & (OSC_WAVE_SAWTRI | OSC_WAVE_TRI)) != 0;
 
     /* pulse width */
     float w = pw * (float) M_PI;
 
-    /* get impulse train */
-    float blit1 = BLIT(n, phase);
-    float blit2 = BLIT(n, wrapTWOPI(w + phase));
+    if (fixedPhase) {
+        /* phase locked loop, wraps on overflow and is exact for any runtime */
+        phaseFixed += incrFixed;
 
-    /* feed integrator */
-    int1.add(blit1, incr);
-    int2.add(blit2, incr);
+        if (first) blit1 = kernel.compute(phaseFixed);
+        if (second) blit2 = kernel.compute(phaseFixed + (uint32_t) (pw * 2147483648.f));
+    } else {
+        /* phase locked loop */
+        phase = wrapTWOPI(incr + phase);
 
-    /* integrator delta */
-    float delta = int1.value - int2.value;
+        /* get impulse train, kernel is 2*PI periodic so the offset phase needs no wrap */
+        if (first) blit1 = kernel.compute(phase);
+        if (second) blit2 = kernel.compute(w + phase);
+    }
+
+    /* nothing patched, only keep the phase running */
+    if (!first) return;
 
-    /* 3rd integrator */
-    float beta = int3.add(delta, incr) * 5.f;
+    /* backwards running phase in through-zero mode, impulses and ramps turn around */
+    if (incr < 0.f) {
+        blit1 = -blit1;
+        blit2 = -blit2;
+    }
+
+    /* integrator coefficient */
+    float rate = fabsf(incr);
+
+    /* feed integrator */
+    int1.add(blit1, rate);
 
     /* compute RAMP waveform */
     ramp = int1.value; //lp1.filter(int1.value);
-    /* compute pulse waveform */
-    pulse = delta * 1.6f;
     /* compute SAW waveform */
     saw = ramp * -1;
 
-    /* compute triangle */
-    tri = (float) M_PI / w * beta;
-    /* compute sawtri */
-    sawtri = saw + beta;
+    if (second) {
+        int2.add(blit2, rate);
+
+        /* integrator delta */
+        float delta = int1.value - int2.value;
+
+        /* compute pulse waveform */
+        pulse = delta * 1.6f;
+
+        if (third) {
+            /* 3rd integrator */
+            float beta = int3.add(delta, rate) * 5.f;
+
+            /* compute triangle */
+            tri = (float) M_PI / w * beta;
+            /* compute sawtri */
+            sawtri = saw + beta;
+        }
+    }
 
     //TODO: warmup oscillator with: y(x)=1-e^-(x/n) and slope
 
@@ -197,14 +342,19 @@ void BLITOscillator::proccess() {
     ramp *= 3;
     saw *= 3;
 
-    dcb1.filter(saw);
-    dcb2.filter(pulse);
+    /* reshape requested waveforms only */
+    if (waveMask & OSC_WAVE_SAW) {
+        dcb1.filter(saw);
+        saw = shape1(OSC_SHAPING, saw);
+    }
+
+    if (waveMask & OSC_WAVE_PULSE) {
+        dcb2.filter(pulse);
+        pulse = shape1(OSC_SHAPING, pulse);
+    }
 
-    /* reshape waveforms */
-    saw = shape1(OSC_SHAPING, saw);
-    pulse = shape1(OSC_SHAPING, pulse);
-    sawtri = shape1(OSC_SHAPING, sawtri);
-    tri = shape1(OSC_SHAPING, tri);
+    if (waveMask & OSC_WAVE_SAWTRI) sawtri = shape1(OSC_SHAPING, sawtri);
+    if (waveMask & OSC_WAVE_TRI) tri = shape1(OSC_SHAPING, tri);
 }
 
 
@@ -212,8 +362,66 @@ void BLITOscillator::proccess() {
  * @brief ReCompute basic parameter
  */
 void BLITOscillator::invalidate() {
-    incr = getPhaseIncrement(freq);
-    n = (int) floorf(BLIT_HARMONICS / freq);
+    hzIncr = TWOPI * isr;
+    hzIncrFixed = 4294967296.f * isr;
+    fmax = sr * 0.45f;
+
+    float f = getModulatedFrequency();
+
+    incr = getPhaseIncrement(f, isr);
+    incrFixed = getPhaseIncrementFixed(f, isr);
+
+    float af = fabsf(f);
+    updateHarmonics(af < 1.f ? 1.f : af);
+}
+
+
+/**
+ * @brief Switch to the harmonic band of a frequency
+ * @param freq Absolute frequency, at least 1 Hz
+ */
+void BLITOscillator::updateHarmonics(float freq) {
+    /* positive, the cast truncates like floorf() without the library call */
+    n = (int) (BLIT_HARMONICS / freq);
+
+    kernel.setHarmonics(n);
+}
+
+
+/**
+ * @brief Get frequency with FM applied, limited to the range of the FM mode
+ * @return
+ */
+float BLITOscillator::getModulatedFrequency() const {
+    return clampModulated(freq + fmHz, fmax, fmMode);
+}
+
+
+/**
+ * @brief Audio rate frequency modulation, adds to the phase increment directly without invalidate()
+ *
+ * The harmonic band is only switched when the modulated frequency leaves it.
+ * @param fm Frequency offset in Hz
+ */
+void BLITOscillator::setFM(float fm) {
+    if (fmHz == fm) return;
+
+    fmHz = fm;
+
+    float f = getModulatedFrequency();
+
+    incr = f * hzIncr;
+    incrFixed = (uint32_t) (int32_t) (f * hzIncrFixed);
+
+    /* still in band if floor(BLIT_HARMONICS / af) == n, checked without division */
+    float af = fabsf(f);
+    if (af < 1.f) af = 1.f;
+
+    float top = n * af;
+
+    if (top > BLIT_HARMONICS || top + af <= BLIT_HARMONICS) {
+        updateHarmonics(af);
+    }
 }
 
 
@@ -232,34 +440,18 @@ float BLITOscillator::getSaturate() const {
  */
 void BLITOscillator::setSaturate(float saturate) {
     BLITOscillator::saturate = saturate;
-
-    /* force recalculation of variables */
-    invalidate();
 }
 
 
 /**
  * @brief Translate from control voltage to frequency
  * @param cv ControlVoltage from MIDI2CV
- * @param fm Frequency modulation
+ * @param fm Frequency offset in Hz, for audio rate FM use setFM()
  * @param oct Octave
  */
 void BLITOscillator::updatePitch(float cv, float fm, float tune, float oct) {
     // CV is at 1V/OCt, C0 = 16.3516Hz, C4 = 261.626Hz
     // 10.3V = 20614.33hz
 
-    /* optimize the usage of expensive exp function and other computations */
-    float coeff = (_oct != oct) ? powf(2.f, oct) : _coeff;
-    float base = (_cv != cv) ? powf(2.f, cv) : _base;
-    float biqufm = (_tune != tune) ? quadraticBipolar(tune) : _biqufm;
-
-    setFrequency((NOTE_C4 + biqufm) * base * coeff + detune + fm);
-
-    /* save states */
-    _cv = cv;
-    _oct = oct;
-    _base = base;
-    _coeff = coeff;
-    _tune = tune;
-    _biqufm = biqufm;
+    setFrequency(pitch.hz(cv, tune, oct) + detune + fm);
 }
\ No newline at end of file
@@ -3,9 +3,15 @@
 #include "DSPMath.hpp"
 
 #define BLIT_HARMONICS 18000.f
-#define NOTE_C4 261.626f
 #define OSC_SHAPING 0.778
 
+#define OSC_WAVE_SAW 0x01
+#define OSC_WAVE_PULSE 0x02
+#define OSC_WAVE_SAWTRI 0x04
+#define OSC_WAVE_TRI 0x08
+#define OSC_WAVE_RAMP 0x10
+#define OSC_WAVE_ALL 0x1F
+
 using namespace rack;
 
 
@@ -16,7 +22,16 @@ struct BLITOscillator {
     float freq;      // oscillator frequency
     float pw;        // pulse-width value
     float phase;     // current phase
-    float incr;      // current phase increment for PLL
+    float incr;      // current phase increment for PLL, negative while running backwards
+    uint32_t phaseFixed; // current phase as fixed-point, one cycle is 2^32
+    uint32_t incrFixed;  // current fixed-point phase increment
+    bool fixedPhase;     // use the fixed-point phase accumulator
+    float fmHz;      // audio rate frequency modulation in Hz
+    int fmMode;      // linear or through-zero FM
+    int waveMask;    // waveforms computed by proccess(), OSC_WAVE_*
+    float sr, isr;   // sample rate and its reciprocal
+    float hzIncr, hzIncrFixed; // phase increments of 1 Hz, cached from the sample rate
+    float fmax;      // highest modulated frequency
     float detune;    // analogue detune
     float drift;     // oscillator drift
     float warmup;    // oscillator warmup detune
@@ -33,8 +48,11 @@ struct BLITOscillator {
     float sawtri;
     float tri;
 
-    /* saved frequency states */
-    float _cv, _oct, _base, _coeff, _tune, _biqufm;
+    /* frequency of the last pitch CV, octave and tune */
+    PitchCache pitch;
+
+    /* Dirichlet kernel of current harmonic band */
+    BLITKernel kernel;
 
     /* leaky integrators */
     Integrator int1;
@@ -65,12 +83,25 @@ struct BLITOscillator {
 
 
     void updatePitch(float cv, float fm, float tune, float oct);
+    void setFM(float fm);
+    float getModulatedFrequency() const;
+    void updateHarmonics(float freq);
 
     /* common getter and setter */
+    float getSampleRate() const;
+    void setSampleRate(float sr);
+    void setSeed(uint32_t seed);
     float getFrequency() const;
+    float getPitch() const;
     void setFrequency(float freq);
     float getPulseWidth() const;
     void setPulseWidth(float pw);
+    bool isFixedPhase() const;
+    void setFixedPhase(bool fixedPhase);
+    int getFMMode() const;
+    void setFMMode(int fmMode);
+    int getWaveMask() const;
+    void setWaveMask(int waveMask);
 
     float getRampWave() const;
     float getSawWave() const;
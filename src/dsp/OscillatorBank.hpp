@@ -0,0 +1,567 @@
+#pragma once
+
+#include "Oscillator.hpp"
+
+namespace rack {
+
+    /**
+     * @brief Polyphonic version of BLITOscillator, processes 4 voices per SSE instruction
+     *
+     * Every voice runs the same BLIT, integrator and shaping chain as a single BLITOscillator,
+     * all state is kept as structure-of-arrays with one voice per lane. The phase is a 32 bit
+     * fixed-point accumulator which wraps on overflow, see BLITOscillator::setFixedPhase(). The
+     * kernel sines are computed by fastSinSSE() straight from the fixed-point phase.
+     *
+     * For unison all voices follow one pitch set by updatePitch() without voice index, detuned
+     * symmetric by setDetune(). Only the groups holding active voices are processed.
+     */
+    template<int VOICES>
+    struct OscillatorBank {
+        static_assert(VOICES % 4 == 0, "OscillatorBank needs a multiple of 4 voices");
+        static const int GROUPS = VOICES / 4;
+
+    private:
+        /* per voice parameters */
+        float freq[VOICES], pw[VOICES], detune[VOICES];
+        float _cv[VOICES], _fm[VOICES], _oct[VOICES], _tune[VOICES];
+        int harmonics[VOICES];
+
+        /* unison and FM shared by all voices */
+        int voices = VOICES;     // active voices
+        bool unison = false;     // pitch set for all voices by updatePitch() without voice index
+        alignas(16) float ratio[VOICES]; // unison detune of each voice
+        float spread = 0.f;      // unison detune of the outer voices in semitones
+        float base = NOTE_C4;    // unison frequency
+        float ucv = 0.f, ufm = 0.f, uoct = 0.f, utune = 0.f;
+        float fmHz = 0.f;
+        int fmMode = FM_MODE_LINEAR;
+        int waveMask = OSC_WAVE_ALL; // waveforms computed by process()
+        float sr = 0.f, isr = 0.f; // sample rate and its reciprocal
+        float hzIncr = 0.f, hzIncrFixed = 0.f, fmax = 0.f;
+
+        /* per voice coefficients, loaded into lanes while processing */
+        alignas(16) uint32_t incr[VOICES];   // fixed-point phase increment
+        alignas(16) uint32_t m2[VOICES];     // Dirichlet kernel of current harmonic band, see BLITKernel::m2
+        alignas(16) uint32_t offset[VOICES]; // pulse width as fixed-point phase offset
+        alignas(16) float fn[VOICES];        // integrator coefficient, phase increment in radians * Integrator::d
+        alignas(16) float triGain[VOICES];
+        alignas(16) float polarity[VOICES];  // -1 while running backwards in through-zero FM
+
+        /* waveform outputs */
+        alignas(16) float ramp[VOICES], saw[VOICES], pulse[VOICES], sawtri[VOICES], tri[VOICES];
+
+        /* oscillator state */
+        __m128i phase[GROUPS];
+        __m128 int1[GROUPS], int2[GROUPS], int3[GROUPS];
+
+        Randomizer rand;
+
+
+        /**
+         * @brief Set sample rate and the increments of 1 Hz derived from it
+         * @param sr
+         */
+        void updateRate(float sr) {
+            OscillatorBank::sr = sr;
+            isr = 1.f / sr;
+
+            hzIncr = TWOPI * isr;
+            hzIncrFixed = 4294967296.f * isr;
+            fmax = sr * 0.45f;
+        }
+
+
+        /**
+         * @brief Recompute the coefficients of one voice
+         * @param voice
+         */
+        void invalidate(int voice) {
+            float f = getModulatedFrequency(voice);
+
+            incr[voice] = getPhaseIncrementFixed(f, isr);
+            offset[voice] = (uint32_t) (pw[voice] * 2147483648.f);
+            triGain[voice] = 1.f / pw[voice];
+
+            updateModulation(voice, f);
+            updateHarmonics(voice, fabsf(f));
+        }
+
+
+        /**
+         * @brief Frequency of a voice with FM applied, see BLITOscillator::getModulatedFrequency()
+         * @param voice
+         * @return
+         */
+        float getModulatedFrequency(int voice) const {
+            return clampModulated(freq[voice] + fmHz, fmax, fmMode);
+        }
+
+
+        /**
+         * @brief Integrator coefficient and direction of a voice
+         * @param voice
+         * @param f Modulated frequency
+         */
+        void updateModulation(int voice, float f) {
+            fn[voice] = fabsf(f) * hzIncr * 0.25f;
+            polarity[voice] = f < 0.f ? -1.f : 1.f;
+        }
+
+
+        /**
+         * @brief Switch a voice to the harmonic band of a frequency
+         * @param voice
+         * @param f Absolute frequency
+         */
+        void updateHarmonics(int voice, float f) {
+            if (f < 1.f) f = 1.f;
+
+            int n = (int) (BLIT_HARMONICS / f);
+
+            harmonics[voice] = n;
+            m2[voice] = (uint32_t) (2 * (n > 1 ? n - 1 : 0) + 1);
+        }
+
+
+        /**
+         * @brief Set the frequency of all active voices from the unison pitch
+         */
+        void updateUnison() {
+            for (int i = 0; i < voices; i++) {
+                setFrequency(i, base * ratio[i] + detune[i] + ufm);
+            }
+        }
+
+
+        /**
+         * @brief Fixed-point phase of the kernel numerator, (m2 * phase) >> 1 modulo 2^32 of four lanes
+         * @param p
+         * @param m
+         * @return
+         */
+        static inline __m128i mulPhase(__m128i p, __m128i m) {
+            /* SSE2 multiplies only the even lanes to 64 bit, so the odd lanes are shifted down */
+            __m128i even = _mm_srli_epi64(_mm_mul_epu32(p, m), 1);
+            __m128i odd = _mm_srli_epi64(_mm_mul_epu32(_mm_srli_epi64(p, 32), _mm_srli_epi64(m, 32)), 1);
+
+            return _mm_or_si128(_mm_and_si128(even, _mm_set_epi32(0, -1, 0, -1)), _mm_slli_epi64(odd, 32));
+        }
+
+
+        /**
+         * @brief Waveshaper of the oscillator outputs, see shape1()
+         * @param x
+         * @return
+         */
+        static inline __m128 shape(__m128 x) {
+            const float k = 2.f * (float) OSC_SHAPING / (1.f - (float) OSC_SHAPING);
+
+            __m128 h = _mm_mul_ps(x, _mm_set1_ps(0.5f));
+            __m128 a = _mm_andnot_ps(_mm_set1_ps(-0.f), h);
+            __m128 b = _mm_div_ps(_mm_mul_ps(_mm_set1_ps(1.f + k), h), _mm_add_ps(_mm_set1_ps(1.f), _mm_mul_ps(_mm_set1_ps(k), a)));
+
+            return _mm_mul_ps(b, _mm_set1_ps(4.f));
+        }
+
+    public:
+
+        OscillatorBank() {
+            updateRate(engineGetSampleRate());
+            reset();
+        }
+
+
+        /**
+         * @brief Set all voices back
+         */
+        void reset() {
+            for (int i = 0; i < VOICES; i++) {
+                pw[i] = 1.f;
+                detune[i] = rand.nextFloat(-0.281273f, 0.2912846f);
+                ratio[i] = 1.f;
+
+                /* what updatePitch() gives for zero CV, so its cache is valid from the start */
+                freq[i] = NOTE_C4 + detune[i];
+
+                _cv[i] = _fm[i] = _oct[i] = _tune[i] = 0.f;
+                ramp[i] = saw[i] = pulse[i] = sawtri[i] = tri[i] = 0.f;
+
+                invalidate(i);
+            }
+
+            for (int g = 0; g < GROUPS; g++) {
+                phase[g] = _mm_setzero_si128();
+                int1[g] = int2[g] = int3[g] = _mm_setzero_ps();
+            }
+        }
+
+
+        /**
+         * @brief Recompute coefficients of all voices
+         */
+        void invalidate() {
+            for (int i = 0; i < VOICES; i++) {
+                invalidate(i);
+            }
+        }
+
+
+        /**
+         * @brief Process next sample of the first G groups
+         *
+         * Every stage runs over all groups before the next one starts, so the independent groups
+         * are interleaved and hide the latency of the long sine and division chains. The group count
+         * is a template parameter, so the stages are unrolled and kept in registers.
+         */
+        template<int G>
+        void processGroups() {
+            const __m128 zero = _mm_setzero_ps();
+            const __m128 one = _mm_set1_ps(1.f);
+            const __m128 two = _mm_set1_ps(2.f);
+            const __m128 three = _mm_set1_ps(3.f);
+            const __m128 five = _mm_set1_ps(5.f);
+
+            /* saw and ramp need the first integrator, pulse the second and sawtri and triangle all three */
+            const bool second = (waveMask & (OSC_WAVE_PULSE | OSC_WAVE_SAWTRI | OSC_WAVE_TRI)) != 0;
+            const bool third = (waveMask & (OSC_WAVE_SAWTRI | OSC_WAVE_TRI)) != 0;
+
+            /* the numerators are replaced by the impulse trains once divided */
+            __m128i t2[G];
+            __m128 den1[G], den2[G], num1[G], num2[G];
+
+            /* phase locked loop, wraps on overflow, the kernel is periodic so the offset phase wraps as well */
+            for (int g = 0; g < G; g++) {
+                phase[g] = _mm_add_epi32(phase[g], _mm_load_si128((const __m128i *) (incr + 4 * g)));
+                t2[g] = _mm_add_epi32(phase[g], _mm_load_si128((const __m128i *) (offset + 4 * g)));
+            }
+
+            /* nothing patched, only keep the phases running */
+            if (waveMask == 0) return;
+
+            /* Dirichlet kernels of both impulse trains, see BLITKernel::compute() */
+            for (int g = 0; g < G; g++) {
+                den1[g] = fastSinSSE(_mm_srli_epi32(phase[g], 1));
+                den2[g] = second ? fastSinSSE(_mm_srli_epi32(t2[g], 1)) : one;
+            }
+
+            for (int g = 0; g < G; g++) {
+                __m128i mv = _mm_load_si128((const __m128i *) (m2 + 4 * g));
+
+                num1[g] = fastSinSSE(mulPhase(phase[g], mv));
+                num2[g] = second ? fastSinSSE(mulPhase(t2[g], mv)) : one;
+            }
+
+            for (int g = 0; g < G; g++) {
+                /* singularity at zero phase, same result as the scalar kernel */
+                __m128 zero1 = _mm_cmpeq_ps(den1[g], zero);
+                __m128 blit1 = _mm_mul_ps(_mm_sub_ps(_mm_div_ps(num1[g], den1[g]), one), two);
+
+                /* backwards running voices in through-zero FM */
+                __m128 sign = _mm_load_ps(polarity + 4 * g);
+
+                num1[g] = _mm_mul_ps(_mm_or_ps(_mm_and_ps(zero1, one), _mm_andnot_ps(zero1, blit1)), sign);
+
+                if (second) {
+                    __m128 zero2 = _mm_cmpeq_ps(den2[g], zero);
+                    __m128 blit2 = _mm_mul_ps(_mm_sub_ps(_mm_div_ps(num2[g], den2[g]), one), two);
+
+                    num2[g] = _mm_mul_ps(_mm_or_ps(_mm_and_ps(zero2, one), _mm_andnot_ps(zero2, blit2)), sign);
+                }
+            }
+
+            for (int g = 0; g < G; g++) {
+                __m128 f = _mm_load_ps(fn + 4 * g);
+
+                /* leaky integrators, the ones of waveforms not requested stand still */
+                int1[g] = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(num1[g], int1[g]), f), int1[g]);
+
+                __m128 s = _mm_sub_ps(zero, int1[g]);
+
+                _mm_store_ps(ramp + 4 * g, _mm_mul_ps(int1[g], three));
+                if (waveMask & OSC_WAVE_SAW) _mm_store_ps(saw + 4 * g, shape(_mm_mul_ps(s, three)));
+
+                if (!second) continue;
+
+                int2[g] = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(num2[g], int2[g]), f), int2[g]);
+
+                __m128 delta = _mm_sub_ps(int1[g], int2[g]);
+
+                if (waveMask & OSC_WAVE_PULSE) _mm_store_ps(pulse + 4 * g, shape(_mm_mul_ps(delta, _mm_set1_ps(1.6f))));
+
+                if (!third) continue;
+
+                int3[g] = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(delta, int3[g]), f), int3[g]);
+
+                __m128 beta = _mm_mul_ps(int3[g], five);
+
+                if (waveMask & OSC_WAVE_SAWTRI) _mm_store_ps(sawtri + 4 * g, shape(_mm_add_ps(s, beta)));
+                if (waveMask & OSC_WAVE_TRI) _mm_store_ps(tri + 4 * g, shape(_mm_mul_ps(beta, _mm_load_ps(triGain + 4 * g))));
+            }
+        }
+
+
+        /**
+         * @brief Process next sample of all active voices, groups without active voices are skipped
+         */
+        void process() {
+            switch ((voices + 3) / 4) {
+                case 1:
+                    processGroups<1>();
+                    break;
+                case 2:
+                    processGroups<(GROUPS < 2 ? GROUPS : 2)>();
+                    break;
+                case 3:
+                    processGroups<(GROUPS < 3 ? GROUPS : 3)>();
+                    break;
+                default:
+                    processGroups<GROUPS>();
+            }
+        }
+
+
+        /**
+         * @brief Set frequency of a voice
+         * @param voice
+         * @param freq
+         */
+        void setFrequency(int voice, float freq) {
+            if (OscillatorBank::freq[voice] != freq) {
+                OscillatorBank::freq[voice] = freq;
+
+                invalidate(voice);
+            }
+        }
+
+
+        /**
+         * @brief Audio rate FM of all voices, see BLITOscillator::setFM()
+         * @param fm Frequency offset in Hz
+         */
+        void setFM(float fm) {
+            if (fmHz == fm) return;
+
+            fmHz = fm;
+
+            for (int i = 0; i < voices; i++) {
+                float f = getModulatedFrequency(i);
+
+                incr[i] = (uint32_t) (int32_t) (f * hzIncrFixed);
+                updateModulation(i, f);
+
+                /* still in band if floor(BLIT_HARMONICS / af) == n */
+                float af = fabsf(f);
+                if (af < 1.f) af = 1.f;
+
+                float top = harmonics[i] * af;
+
+                if (top > BLIT_HARMONICS || top + af <= BLIT_HARMONICS) {
+                    updateHarmonics(i, af);
+                }
+            }
+        }
+
+
+        float getSampleRate() const {
+            return sr;
+        }
+
+
+        /**
+         * @brief Set sample rate of all voices, recomputes their coefficients on change
+         * @param sr
+         */
+        void setSampleRate(float sr) {
+            if (OscillatorBank::sr != sr) {
+                updateRate(sr);
+                invalidate();
+            }
+        }
+
+
+        int getFMMode() const {
+            return fmMode;
+        }
+
+
+        /**
+         * @brief Set FM mode of all voices
+         * @param fmMode FM_MODE_LINEAR or FM_MODE_THROUGH_ZERO
+         */
+        void setFMMode(int fmMode) {
+            if (OscillatorBank::fmMode != fmMode) {
+                OscillatorBank::fmMode = fmMode;
+
+                invalidate();
+            }
+        }
+
+
+        int getWaveMask() const {
+            return waveMask;
+        }
+
+
+        /**
+         * @brief Compute only the requested waveforms of all voices, see BLITOscillator::setWaveMask()
+         * @param waveMask Combination of OSC_WAVE_* flags
+         */
+        void setWaveMask(int waveMask) {
+            OscillatorBank::waveMask = waveMask;
+        }
+
+
+        int getVoices() const {
+            return voices;
+        }
+
+
+        /**
+         * @brief Set number of processed voices, the others stand still
+         *
+         * In unison the detune is spread over the new number of voices, voices with their own pitch keep it.
+         *
+         * @param voices 1..VOICES
+         */
+        void setVoices(int voices) {
+            voices = voices < 1 ? 1 : (voices > VOICES ? VOICES : voices);
+
+            if (OscillatorBank::voices != voices) {
+                OscillatorBank::voices = voices;
+
+                if (unison) setDetune(spread, true);
+            }
+        }
+
+
+        float getDetune() const {
+            return spread;
+        }
+
+
+        /**
+         * @brief Unison detune, the active voices are spread evenly between -detune and +detune
+         * @param semitones Detune of the outer voices
+         * @param force Recompute even if unchanged
+         */
+        void setDetune(float semitones, bool force = false) {
+            if (spread == semitones && !force) return;
+
+            spread = semitones;
+
+            alignas(16) float octaves[VOICES];
+
+            for (int i = 0; i < VOICES; i++) {
+                float position = voices > 1 ? 2.f * i / (voices - 1) - 1.f : 0.f;
+                octaves[i] = position * semitones * (1.f / 12.f);
+            }
+
+            for (int g = 0; g < GROUPS; g++) {
+                _mm_store_ps(ratio + 4 * g, fastExp2SSE(_mm_load_ps(octaves + 4 * g)));
+            }
+
+            updateUnison();
+        }
+
+
+        /**
+         * @brief Unison pitch of all active voices, the exponential is shared by all voices
+         * @param cv ControlVoltage at 1V/Oct
+         * @param fm Frequency modulation in Hz
+         * @param tune
+         * @param oct Octave
+         */
+        void updatePitch(float cv, float fm, float tune, float oct) {
+            if (unison && ucv == cv && ufm == fm && uoct == oct && utune == tune) return;
+
+            unison = true;
+
+            ucv = cv;
+            ufm = fm;
+            uoct = oct;
+            utune = tune;
+
+            base = (NOTE_C4 + quadraticBipolar(tune)) * fastExp2(cv + oct);
+
+            updateUnison();
+        }
+
+
+        /**
+         * @brief Set pulse-width of a voice
+         * @param voice
+         * @param pw 0.1..1
+         */
+        void setPulseWidth(int voice, float pw) {
+            pw = clampf(pw, 0.1f, 1.f);
+
+            if (OscillatorBank::pw[voice] != pw) {
+                OscillatorBank::pw[voice] = pw;
+
+                invalidate(voice);
+            }
+        }
+
+
+        /**
+         * @brief Translate from control voltage to frequency, see BLITOscillator::updatePitch()
+         * @param voice
+         * @param cv ControlVoltage at 1V/Oct
+         * @param fm Frequency modulation
+         * @param tune
+         * @param oct Octave
+         */
+        void updatePitch(int voice, float cv, float fm, float tune, float oct) {
+            unison = false;
+
+            if (_cv[voice] == cv && _fm[voice] == fm && _oct[voice] == oct && _tune[voice] == tune) return;
+
+            _cv[voice] = cv;
+            _fm[voice] = fm;
+            _oct[voice] = oct;
+            _tune[voice] = tune;
+
+            setFrequency(voice, (NOTE_C4 + quadraticBipolar(tune)) * fastExp2(cv + oct) + detune[voice] + fm);
+        }
+
+
+        float getFrequency(int voice) const {
+            return freq[voice];
+        }
+
+
+        float getUnisonFrequency() const {
+            return base;
+        }
+
+
+        float getPulseWidth(int voice) const {
+            return pw[voice];
+        }
+
+
+        float getRampWave(int voice) const {
+            return ramp[voice];
+        }
+
+
+        float getSawWave(int voice) const {
+            return saw[voice];
+        }
+
+
+        float getPulseWave(int voice) const {
+            return pulse[voice];
+        }
+
+
+        float getSawTriWave(int voice) const {
+            return sawtri[voice];
+        }
+
+
+        float getTriangleWave(int voice) const {
+            return tri[voice];
+        }
+    };
+}
@@ -0,0 +1,29 @@
+#include <cmath>
+#include "Oversampler.hpp"
+
+
+/**
+ * @brief Design a windowed-sinc lowpass FIR with Blackman-Harris window
+ * @param h Destination for the coefficients
+ * @param taps Number of taps
+ * @param cutoff Cutoff frequency relative to the sample rate (0..0.5)
+ */
+void designLowpass(float *h, int taps, float cutoff) {
+    double sum = 0.;
+
+    for (int i = 0; i < taps; i++) {
+        double t = i - (taps - 1) / 2.;
+        double x = 2. * M_PI * cutoff * t;
+        double sinc = (t == 0.) ? 1. : sin(x) / x;
+        double p = 2. * M_PI * i / (taps - 1);
+        double w = 0.35875 - 0.48829 * cos(p) + 0.14128 * cos(2. * p) - 0.01168 * cos(3. * p);
+
+        h[i] = (float) (sinc * w);
+        sum += h[i];
+    }
+
+    /* normalize to unity gain at DC */
+    for (int i = 0; i < taps; i++) {
+        h[i] = (float) (h[i] / sum);
+    }
+}
@@ -0,0 +1,315 @@
+#pragma once
+
+#include <cstring>
+#include <xmmintrin.h>
+
+#define OVERSAMPLE_MAX 16
+#define OVERSAMPLE_QUALITY 8
+#define OVERSAMPLE_CUTOFF 0.9f
+
+
+/**
+ * @brief Design a windowed-sinc (Blackman-Harris) lowpass FIR
+ * @param h Destination for the coefficients
+ * @param taps Number of taps
+ * @param cutoff Cutoff frequency relative to the sample rate (0..0.5)
+ */
+void designLowpass(float *h, int taps, float cutoff);
+
+
+/**
+ * @brief Anti-imaging / anti-aliasing kernel for a given oversampling factor, shared by all instances
+ */
+template<int FACTOR>
+struct PolyphaseKernel {
+    static const int TAPS = FACTOR * OVERSAMPLE_QUALITY;
+
+    /* prototype filter, used by the decimator */
+    float h[TAPS];
+    /* prototype filter broadcasted to all lanes, for multi-channel decimation */
+    __m128 hv[TAPS];
+    /* polyphase branches of the prototype filter, gain compensated for zero stuffing */
+    float branch[FACTOR][OVERSAMPLE_QUALITY];
+    /* polyphase branches broadcasted to all lanes, for multi-voice interpolation */
+    __m128 branchv[FACTOR][OVERSAMPLE_QUALITY];
+
+    static const PolyphaseKernel instance;
+
+
+    /**
+     * @brief Compute prototype filter and its polyphase decomposition
+     */
+    PolyphaseKernel() {
+        designLowpass(h, TAPS, OVERSAMPLE_CUTOFF * 0.5f / FACTOR);
+
+        for (int i = 0; i < TAPS; i++) {
+            hv[i] = _mm_set1_ps(h[i]);
+        }
+
+        for (int p = 0; p < FACTOR; p++) {
+            for (int j = 0; j < OVERSAMPLE_QUALITY; j++) {
+                branch[p][j] = h[p + j * FACTOR] * FACTOR;
+                branchv[p][j] = _mm_set1_ps(branch[p][j]);
+            }
+        }
+    }
+};
+
+
+template<int FACTOR>
+const PolyphaseKernel<FACTOR> PolyphaseKernel<FACTOR>::instance;
+
+
+/**
+ * @brief 4-lane polyphase FIR interpolator, every lane is upsampled independently
+ */
+struct InterpolatorSSE {
+    /* input history, newest frame first */
+    __m128 x[OVERSAMPLE_QUALITY];
+
+
+    InterpolatorSSE() {
+        reset();
+    }
+
+
+    /**
+     * @brief Clear filter state
+     */
+    void reset() {
+        memset(x, 0, sizeof(x));
+    }
+
+
+    /**
+     * @brief Upsample the next input frame
+     * @param in Next input frame
+     * @param out Destination for FACTOR frames
+     */
+    template<int FACTOR>
+    void process(__m128 in, __m128 *out) {
+        const PolyphaseKernel<FACTOR> &k = PolyphaseKernel<FACTOR>::instance;
+
+        for (int j = OVERSAMPLE_QUALITY - 1; j > 0; j--) {
+            x[j] = x[j - 1];
+        }
+
+        x[0] = in;
+
+        for (int p = 0; p < FACTOR; p++) {
+            __m128 y0 = _mm_mul_ps(k.branchv[p][0], x[0]);
+            __m128 y1 = _mm_mul_ps(k.branchv[p][1], x[1]);
+
+            for (int j = 2; j < OVERSAMPLE_QUALITY; j += 2) {
+                y0 = _mm_add_ps(y0, _mm_mul_ps(k.branchv[p][j], x[j]));
+                y1 = _mm_add_ps(y1, _mm_mul_ps(k.branchv[p][j + 1], x[j + 1]));
+            }
+
+            out[p] = _mm_add_ps(y0, y1);
+        }
+    }
+};
+
+
+/**
+ * @brief 4-lane FIR decimator, every lane is a channel with its own state
+ */
+struct DecimatorSSE {
+    /* history, stored twice to read the convolution without wrapping */
+    __m128 buffer[2 * OVERSAMPLE_MAX * OVERSAMPLE_QUALITY];
+    int pos;
+
+
+    DecimatorSSE() {
+        reset();
+    }
+
+
+    /**
+     * @brief Clear filter state
+     */
+    void reset() {
+        memset(buffer, 0, sizeof(buffer));
+        pos = 0;
+    }
+
+
+    /**
+     * @brief Decimate one block of frames
+     * @param in FACTOR frames, oldest first
+     * @return Downsampled frame
+     */
+    template<int FACTOR>
+    __m128 process(const __m128 *in) {
+        const PolyphaseKernel<FACTOR> &k = PolyphaseKernel<FACTOR>::instance;
+        const int taps = PolyphaseKernel<FACTOR>::TAPS;
+
+        /* insert new block reversed, so the newest frame is at the lowest index */
+        pos -= FACTOR;
+        if (pos < 0) pos += taps;
+
+        for (int i = 0; i < FACTOR; i++) {
+            buffer[pos + i] = in[FACTOR - 1 - i];
+            buffer[pos + i + taps] = in[FACTOR - 1 - i];
+        }
+
+        /* all lanes at once, four accumulators to hide the add latency */
+        const __m128 *b = buffer + pos;
+        __m128 y0 = _mm_setzero_ps();
+        __m128 y1 = _mm_setzero_ps();
+        __m128 y2 = _mm_setzero_ps();
+        __m128 y3 = _mm_setzero_ps();
+
+        for (int i = 0; i < taps; i += 4) {
+            y0 = _mm_add_ps(y0, _mm_mul_ps(k.hv[i], b[i]));
+            y1 = _mm_add_ps(y1, _mm_mul_ps(k.hv[i + 1], b[i + 1]));
+            y2 = _mm_add_ps(y2, _mm_mul_ps(k.hv[i + 2], b[i + 2]));
+            y3 = _mm_add_ps(y3, _mm_mul_ps(k.hv[i + 3], b[i + 3]));
+        }
+
+        return _mm_add_ps(_mm_add_ps(y0, y1), _mm_add_ps(y2, y3));
+    }
+};
+
+
+/**
+ * @brief Polyphase FIR oversampler with selectable factor of 2x, 4x, 8x or 16x
+ *
+ * The factor is set at runtime and dispatched to kernels which are specialized at compile time,
+ * so the inner loops have fixed trip counts. Up to 4 channels are decimated in one SSE pass,
+ * one channel per lane, each with its own filter state.
+ */
+template<int CHANNELS>
+struct Oversampler {
+    static_assert(CHANNELS <= 4, "Oversampler supports up to 4 channels");
+
+    float up[OVERSAMPLE_MAX];
+    /* oversampled output frames, one lane per channel */
+    alignas(16) float data[OVERSAMPLE_MAX][4];
+    int factor = 8;
+
+private:
+    DecimatorSSE decimator;
+    __m128 down;
+    /* input history of the interpolator, newest sample first */
+    float x[OVERSAMPLE_QUALITY];
+
+public:
+
+    /**
+     * @brief Upsample the next input sample with a fixed factor, see doUpsample()
+     * @param in Next sample point
+     */
+    template<int FACTOR>
+    void upsample(float in) {
+        const PolyphaseKernel<FACTOR> &k = PolyphaseKernel<FACTOR>::instance;
+
+        for (int j = OVERSAMPLE_QUALITY - 1; j > 0; j--) {
+            x[j] = x[j - 1];
+        }
+
+        x[0] = in;
+
+        for (int p = 0; p < FACTOR; p++) {
+            float y = 0.f;
+
+            for (int j = 0; j < OVERSAMPLE_QUALITY; j++) {
+                y += k.branch[p][j] * x[j];
+            }
+
+            up[p] = y;
+        }
+    }
+
+
+    /**
+     * @brief Downsample all channels with a fixed factor, see doDownsample()
+     */
+    template<int FACTOR>
+    void downsample() {
+        down = decimator.process<FACTOR>((const __m128 *) data);
+    }
+
+
+    Oversampler() {
+        reset();
+    }
+
+
+    /**
+     * @brief Clear all filter states
+     */
+    void reset() {
+        memset(x, 0, sizeof(x));
+        memset(up, 0, sizeof(up));
+        memset(data, 0, sizeof(data));
+
+        decimator.reset();
+        down = _mm_setzero_ps();
+    }
+
+
+    /**
+     * @brief Select oversampling factor, unsupported values fall back to 8x
+     * @param factor 2, 4, 8 or 16
+     */
+    void setFactor(int factor) {
+        if (factor != 2 && factor != 4 && factor != 8 && factor != 16) factor = 8;
+
+        if (Oversampler::factor != factor) {
+            Oversampler::factor = factor;
+            reset();
+        }
+    }
+
+
+    /**
+     * @brief Create up-sampled data out of the next input sample
+     * @param in Next sample point
+     */
+    void doUpsample(float in) {
+        switch (factor) {
+            case 2:
+                upsample<2>(in);
+                break;
+            case 4:
+                upsample<4>(in);
+                break;
+            case 16:
+                upsample<16>(in);
+                break;
+            default:
+                upsample<8>(in);
+        }
+    }
+
+
+    /**
+     * @brief Downsample all channels of the current block, write the block to data[point][channel] before
+     */
+    void doDownsample() {
+        switch (factor) {
+            case 2:
+                downsample<2>();
+                break;
+            case 4:
+                downsample<4>();
+                break;
+            case 16:
+                downsample<16>();
+                break;
+            default:
+                downsample<8>();
+        }
+    }
+
+
+    /**
+     * @brief Get downsampled point of a given channel
+     * @param channel Channel to proccess
+     * @return Downsampled point
+     */
+    float getDownsampled(int channel) const {
+        return ((const float *) &down)[channel];
+    }
+};
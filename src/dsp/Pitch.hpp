@@ -0,0 +1,157 @@
+#pragma once
+
+#include <cstdint>
+#include <emmintrin.h>
+#include "DSPHost.hpp"
+
+/* octaves covered by the cutoff range 0..1 (20Hz..20kHz), log2(1000) */
+#define CUTOFF_OCTAVES 9.96578428f
+#define CUTOFF_MIN_HZ 20.f
+
+/* max. error of fastExp2() and fastExp2SSE() against the exact 2^x of the float input */
+#define PITCH_MAX_ERROR_CENTS 0.006f
+
+#define NOTE_C4 261.626f
+
+#define FM_MODE_LINEAR 0
+#define FM_MODE_THROUGH_ZERO 1
+
+
+/**
+ * Pitch and frequency conversion without powf(), shared by oscillators and filters.
+ *
+ * 2^x is split into the integer part, moved straight into the float exponent, and the fractional
+ * part in -0.5..0.5, approximated by a 5th order polynomial. The error is relative and therefore
+ * the same in cents for every octave, see PITCH_MAX_ERROR_CENTS. A polynomial instead of a table
+ * keeps the SSE version free of gathers, which SSE2 does not have. The polynomial is evaluated in
+ * Estrin form, the three linear terms are independent and shorten the dependency chain.
+ */
+
+
+/**
+ * @brief Fast 2^x
+ * @param x Exponent, clamped to -126..126
+ * @return
+ */
+inline float fastExp2(float x) {
+    if (x < -126.f) x = -126.f;
+    if (x > 126.f) x = 126.f;
+
+    /* round to nearest, so the polynomial only has to cover -0.5..0.5 */
+    int i = (int) (x + (x < 0.f ? -0.5f : 0.5f));
+    float f = x - i;
+    float f2 = f * f;
+
+    float a = 1.f + 0.693147181f * f;
+    float b = 0.240226507f + 0.0555041087f * f;
+    float c = 0.00961812911f + 0.00133335581f * f;
+    float p = a + f2 * (b + f2 * c);
+
+    union {
+        float f;
+        int32_t i;
+    } e;
+
+    e.i = (i + 127) << 23;
+
+    return p * e.f;
+}
+
+
+/**
+ * @brief Fast 2^x of four values, same polynomial as fastExp2()
+ * @param x Exponents, clamped to -126..126
+ * @return
+ */
+inline __m128 fastExp2SSE(__m128 x) {
+    x = _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(-126.f)), _mm_set1_ps(126.f));
+
+    /* round to nearest with the default rounding mode */
+    __m128i i = _mm_cvtps_epi32(x);
+    __m128 f = _mm_sub_ps(x, _mm_cvtepi32_ps(i));
+    __m128 f2 = _mm_mul_ps(f, f);
+
+    __m128 a = _mm_add_ps(_mm_set1_ps(1.f), _mm_mul_ps(_mm_set1_ps(0.693147181f), f));
+    __m128 b = _mm_add_ps(_mm_set1_ps(0.240226507f), _mm_mul_ps(_mm_set1_ps(0.0555041087f), f));
+    __m128 c = _mm_add_ps(_mm_set1_ps(0.00961812911f), _mm_mul_ps(_mm_set1_ps(0.00133335581f), f));
+    __m128 p = _mm_add_ps(a, _mm_mul_ps(f2, _mm_add_ps(b, _mm_mul_ps(f2, c))));
+
+    __m128i e = _mm_slli_epi32(_mm_add_epi32(i, _mm_set1_epi32(127)), 23);
+
+    return _mm_mul_ps(p, _mm_castsi128_ps(e));
+}
+
+
+/**
+ * @brief Translate filter cutoff to Hz on a logarithmic scale, same as 20 * 1000^cutoff
+ * @param cutoff 0..1 for 20Hz..20kHz
+ * @return
+ */
+inline float cutoffToHz(float cutoff) {
+    return CUTOFF_MIN_HZ * fastExp2(cutoff * CUTOFF_OCTAVES);
+}
+
+
+/**
+ * @brief Translate four filter cutoffs to Hz, see cutoffToHz()
+ * @param cutoff 0..1 for 20Hz..20kHz
+ * @return
+ */
+inline __m128 cutoffToHzSSE(__m128 cutoff) {
+    return _mm_mul_ps(_mm_set1_ps(CUTOFF_MIN_HZ), fastExp2SSE(_mm_mul_ps(cutoff, _mm_set1_ps(CUTOFF_OCTAVES))));
+}
+
+
+/**
+ * @brief Frequency of an oscillator from V/Oct CV, octave and tune knob, shared by all oscillator cores
+ *
+ * Every term is only recomputed when its input changed since the last call, so calling it every sample with
+ * static knobs costs three compares.
+ */
+struct PitchCache {
+    float cv = 0.f, oct = 0.f, tune = 0.f;
+    float base = 1.f, coeff = 1.f, biqufm = 0.f;
+    float freq = NOTE_C4; // result of the last hz()
+
+
+    /**
+     * @brief Translate from control voltage to frequency
+     * @param cv ControlVoltage at 1V/Oct, C4 at 0V
+     * @param tune Tune knob, bipolar offset in Hz
+     * @param oct Octave
+     * @return Frequency in Hz
+     */
+    inline float hz(float cv, float tune, float oct) {
+        if (PitchCache::oct != oct) {
+            PitchCache::oct = oct;
+            coeff = fastExp2(oct);
+        }
+
+        if (PitchCache::cv != cv) {
+            PitchCache::cv = cv;
+            base = fastExp2(cv);
+        }
+
+        if (PitchCache::tune != tune) {
+            PitchCache::tune = tune;
+            biqufm = rack::quadraticBipolar(tune);
+        }
+
+        return freq = (NOTE_C4 + biqufm) * base * coeff;
+    }
+};
+
+
+/**
+ * @brief Limit a frequency with FM applied to the range of the FM mode
+ * @param f Frequency in Hz
+ * @param fmax Highest modulated frequency
+ * @param fmMode FM_MODE_LINEAR or FM_MODE_THROUGH_ZERO
+ * @return
+ */
+inline float clampModulated(float f, float fmax, int fmMode) {
+    float fmin = fmMode == FM_MODE_THROUGH_ZERO ? -fmax : 0.f;
+
+    /* plain compares, fminf() and fmaxf() are library calls with NaN handling enabled */
+    return f < fmin ? fmin : (f > fmax ? fmax : f);
+}
@@ -0,0 +1,167 @@
+#pragma once
+
+#include "Waveshaper.hpp"
+
+namespace rack {
+
+    /**
+     * @brief Polyphonic version of the ReShaper curve, processes 4 voices per SSE instruction
+     *
+     * Every voice has its own amount, meant to be set at control rate. After one of the amounts of a group
+     * changed, its curve coefficients are ramped linear to the new amounts over the next setRamp() samples. The division of the
+     * rational curve is replaced by fastRcpSSE(). With ADAA enabled every voice runs through its own
+     * first-order antiderivative stage, see ADAASSE.
+     */
+    template<int VOICES>
+    struct ReShaperCurveBank {
+        static_assert(VOICES % 4 == 0, "ReShaperCurveBank needs a multiple of 4 voices");
+        static const int GROUPS = VOICES / 4;
+
+    private:
+        /* per voice parameters */
+        alignas(16) float amount[VOICES]; // target amounts
+        bool changed[GROUPS];
+        bool stale[GROUPS];               // antiderivative terms skipped while ramping without ADAA
+        int ramp = 1;                     // samples to reach new amounts
+        int rampCount[GROUPS];            // samples left in the current ramp
+        __m128 da[GROUPS];                // ramp step of the amounts per sample
+        bool adaa = false;
+        bool primed = false; // ADAA state follows the input
+
+        /* signal in- and outputs */
+        alignas(16) float in[VOICES], out[VOICES];
+
+        /* curve and antiderivative state of each group */
+        ADAASSE<ReShaperCurveSSE> stage[GROUPS];
+
+    public:
+
+        ReShaperCurveBank() {
+            for (int i = 0; i < VOICES; i++) {
+                amount[i] = 1.f;
+                in[i] = 0.f;
+                out[i] = 0.f;
+            }
+
+            for (int g = 0; g < GROUPS; g++) {
+                changed[g] = true;
+                stale[g] = false;
+                rampCount[g] = 0;
+                da[g] = _mm_setzero_ps();
+            }
+        }
+
+
+        /**
+         * @brief Set amount of one voice
+         * @param voice
+         * @param a 1..50
+         */
+        void setAmount(int voice, float a) {
+            if (amount[voice] != a) {
+                amount[voice] = a;
+                changed[voice / 4] = true;
+            }
+        }
+
+
+        /**
+         * @brief Set the length of the ramp to new amounts, usually the control rate of the caller
+         * @param steps Samples, 1 applies new amounts right away
+         */
+        void setRamp(int steps) {
+            ramp = steps < 1 ? 1 : steps;
+        }
+
+
+        /**
+         * @brief Switch between the plain curve and ADAA, a switch to ADAA starts from the current input
+         * @param adaa
+         */
+        void setADAA(bool adaa) {
+            ReShaperCurveBank::adaa = adaa;
+        }
+
+
+        /**
+         * @brief Get ADAA mode
+         * @return
+         */
+        bool getADAA() const {
+            return adaa;
+        }
+
+
+        /**
+         * @brief Set input of one voice
+         * @param voice
+         * @param x -1..1
+         */
+        void setIn(int voice, float x) {
+            in[voice] = x;
+        }
+
+
+        /**
+         * @brief Get output of one voice
+         * @param voice
+         * @return
+         */
+        float getOut(int voice) const {
+            return out[voice];
+        }
+
+
+        /**
+         * @brief Shape one sample of all voices
+         */
+        void process() {
+            for (int g = 0; g < GROUPS; g++) {
+                if (changed[g]) {
+                    /* new targets, ramp from the current amounts */
+                    da[g] = _mm_div_ps(_mm_sub_ps(_mm_load_ps(amount + 4 * g), stage[g].curve.a),
+                                       _mm_set1_ps((float) ramp));
+                    rampCount[g] = ramp;
+                    changed[g] = false;
+                }
+
+                if (rampCount[g] > 0) {
+                    /* the last sample of a ramp hits the target exactly */
+                    __m128 a = --rampCount[g] > 0 ? _mm_add_ps(stage[g].curve.a, da[g]) : _mm_load_ps(amount + 4 * g);
+
+                    /* only ADAA needs the antiderivative terms and its state kept continuous */
+                    if (adaa) {
+                        stage[g].curve.setAmount(a);
+                        stage[g].update();
+                        stale[g] = false;
+                    } else {
+                        stage[g].curve.setValueAmount(a);
+                        stale[g] = true;
+                    }
+                } else if (adaa && stale[g]) {
+                    /* catch up with a ramp without ADAA */
+                    stage[g].curve.setAmount(stage[g].curve.a);
+                    stage[g].update();
+                    stale[g] = false;
+                }
+
+                __m128 x = _mm_load_ps(in + 4 * g);
+
+                if (!adaa) {
+                    _mm_store_ps(out + 4 * g, stage[g].curve.value(x));
+                    continue;
+                }
+
+                /* without a previous input the first step would be from zero */
+                if (!primed) {
+                    stage[g].x1 = x;
+                    stage[g].update();
+                }
+
+                _mm_store_ps(out + 4 * g, stage[g].process(x));
+            }
+
+            primed = adaa;
+        }
+    };
+}
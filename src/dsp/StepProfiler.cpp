@@ -0,0 +1,135 @@
+#include <algorithm>
+#include <mutex>
+#include "StepProfiler.hpp"
+
+#define PROFILER_CALIBRATION_MS 20 // time stamp counter against the steady clock, fixed after this time
+
+namespace rack {
+
+    /* start of the calibration, set once by the first profiler */
+    static std::once_flag calibrationStarted;
+    static std::chrono::steady_clock::time_point calibrationTime;
+    static uint64_t calibrationTicks;
+
+    /* calibrated tick length, 0 until PROFILER_CALIBRATION_MS have passed */
+    static std::atomic<double> tickNanoseconds(0.);
+
+
+    /**
+     * @brief Zero all counters, only called by the writer thread or on construction
+     */
+    void StepProfiler::clear() {
+        for (int i = 0; i < PROFILER_BUCKETS; i++) {
+            buckets[i].store(0, std::memory_order_relaxed);
+        }
+
+        maxTicks.store(0, std::memory_order_relaxed);
+    }
+
+
+    /**
+     * @brief Representative cost of a bucket, the middle of its range
+     * @param bucket
+     * @return
+     */
+    double StepProfiler::bucketTicks(int bucket) {
+        if (bucket < PROFILER_SUBBUCKETS) return bucket;
+
+        int octave = bucket / PROFILER_SUBBUCKETS + 1;
+        uint64_t width = 1ULL << (octave - 2);
+        uint64_t lower = (PROFILER_SUBBUCKETS + bucket % PROFILER_SUBBUCKETS) * width;
+
+        return lower + 0.5 * (width - 1);
+    }
+
+
+    /**
+     * @brief Take the start point of the tick calibration, only the first call counts
+     *
+     * Called by the constructor, so the calibration runs in the background from the first module on and never
+     * has to wait for the clocks.
+     */
+    void StepProfiler::startCalibration() {
+        std::call_once(calibrationStarted, []() {
+            calibrationTime = std::chrono::steady_clock::now();
+            calibrationTicks = now();
+        });
+    }
+
+
+    /**
+     * @brief Duration of one tick of now(), never blocks
+     *
+     * Measured against the steady clock since startCalibration(). Until PROFILER_CALIBRATION_MS have passed
+     * the result is refined with every call, afterwards it is fixed.
+     *
+     * @return Nanoseconds
+     */
+    double StepProfiler::getTickNanoseconds() {
+#if defined(__x86_64__) || defined(__i386__)
+        double ns = tickNanoseconds.load(std::memory_order_relaxed);
+        if (ns > 0.) return ns;
+
+        startCalibration();
+
+        uint64_t ticks = now() - calibrationTicks;
+        double elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - calibrationTime).count();
+
+        if (ticks == 0) return 1.;
+
+        ns = elapsed / ticks;
+
+        if (elapsed >= PROFILER_CALIBRATION_MS * 1e6) tickNanoseconds.store(ns, std::memory_order_relaxed);
+
+        return ns;
+#else
+        return 1.;
+#endif
+    }
+
+
+    /**
+     * @brief Percentiles of all steps recorded since the last reset, safe to call from any thread
+     *
+     * The counters are read one by one while the writer goes on, so the result may be off by the few steps
+     * recorded meanwhile.
+     *
+     * @return
+     */
+    StepProfile StepProfiler::getProfile() const {
+        StepProfile profile;
+        uint64_t counts[PROFILER_BUCKETS];
+
+        for (int i = 0; i < PROFILER_BUCKETS; i++) {
+            counts[i] = buckets[i].load(std::memory_order_relaxed);
+            profile.count += counts[i];
+        }
+
+        if (profile.count == 0) return profile;
+
+        double ns = getTickNanoseconds();
+        profile.max = maxTicks.load(std::memory_order_relaxed) * ns;
+
+        /* smallest bucket holding the given share of all steps */
+        uint64_t rank50 = (profile.count + 1) / 2;
+        uint64_t rank99 = profile.count - profile.count / 100;
+        uint64_t sum = 0;
+
+        for (int i = 0; i < PROFILER_BUCKETS; i++) {
+            uint64_t next = sum + counts[i];
+
+            if (sum < rank50 && next >= rank50) profile.p50 = bucketTicks(i) * ns;
+            if (sum < rank99 && next >= rank99) profile.p99 = bucketTicks(i) * ns;
+
+            sum = next;
+        }
+
+        /* the middle of the top bucket may lie above the largest step */
+        if (profile.max > 0.) {
+            profile.p50 = std::min(profile.p50, profile.max);
+            profile.p99 = std::min(profile.p99, profile.max);
+        }
+
+        return profile;
+    }
+}
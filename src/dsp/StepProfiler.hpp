@@ -0,0 +1,117 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#define PROFILER_SUBBUCKETS 4                        // buckets per octave, resolution is about 12.5%
+#define PROFILER_BUCKETS (PROFILER_SUBBUCKETS * 63)  // covers the full 64 bit range of ticks
+
+namespace rack {
+
+    /**
+     * @brief Percentiles of a StepProfiler in nanoseconds
+     */
+    struct StepProfile {
+        uint64_t count = 0; // recorded steps
+        double p50 = 0.;
+        double p99 = 0.;
+        double max = 0.;
+    };
+
+
+    /**
+     * @brief Lock-free histogram of the cost of a step
+     *
+     * Written by exactly one thread, the audio thread, and read by any other thread. The writer owns all
+     * counters, so they are updated with plain relaxed stores instead of atomic read-modify-write. A reset
+     * is only requested by the reader and carried out by the writer with the next record().
+     *
+     * Costs are measured in ticks of now(), the time stamp counter on x86 and the steady clock otherwise.
+     * Buckets are logarithmic with PROFILER_SUBBUCKETS steps per octave.
+     */
+    struct StepProfiler {
+    private:
+        std::atomic<uint64_t> buckets[PROFILER_BUCKETS];
+        std::atomic<uint64_t> maxTicks;
+        std::atomic<bool> resetRequested;
+
+        static double bucketTicks(int bucket);
+        static void startCalibration();
+        void clear();
+
+    public:
+
+        StepProfiler() {
+            clear();
+            resetRequested = false;
+
+            startCalibration();
+        }
+
+
+        StepProfiler(const StepProfiler &) = delete;
+        StepProfiler &operator=(const StepProfiler &) = delete;
+
+
+        /**
+         * @brief Current tick count, cheap enough to bracket a single step
+         * @return
+         */
+        static inline uint64_t now() {
+#if defined(__x86_64__) || defined(__i386__)
+            return __rdtsc();
+#else
+            return (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+        }
+
+
+        /**
+         * @brief Logarithmic bucket of a measurement, the lowest ones hold single ticks
+         * @param ticks
+         * @return 0..PROFILER_BUCKETS-1
+         */
+        static inline int bucketOf(uint64_t ticks) {
+            if (ticks < PROFILER_SUBBUCKETS) return (int) ticks;
+
+            /* the two bits below the leading one select the sub-bucket */
+            int octave = 63 - __builtin_clzll(ticks);
+            return PROFILER_SUBBUCKETS * (octave - 1) + (int) ((ticks >> (octave - 2)) & (PROFILER_SUBBUCKETS - 1));
+        }
+
+
+        /**
+         * @brief Add one measurement, only called by the writer thread
+         * @param ticks Difference of two now() calls
+         */
+        inline void record(uint64_t ticks) {
+            if (resetRequested.load(std::memory_order_relaxed)) {
+                clear();
+                resetRequested.store(false, std::memory_order_relaxed);
+            }
+
+            std::atomic<uint64_t> &bucket = buckets[bucketOf(ticks)];
+            bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+            if (ticks > maxTicks.load(std::memory_order_relaxed)) maxTicks.store(ticks, std::memory_order_relaxed);
+        }
+
+
+        /**
+         * @brief Drop all measurements, takes effect with the next record()
+         */
+        void reset() {
+            resetRequested.store(true, std::memory_order_relaxed);
+        }
+
+
+        StepProfile getProfile() const;
+        static double getTickNanoseconds();
+    };
+}
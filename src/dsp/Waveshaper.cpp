@@ -0,0 +1,41 @@
+#include "Waveshaper.hpp"
+
+using namespace rack;
+
+
+const OverdriveTable overdriveTable;
+
+
+/**
+ * @brief Integrate overdrive() outwards from F(0) = 0 with Simpson's rule in double precision
+ */
+OverdriveTable::OverdriveTable() {
+    const int steps = 8;
+    const double h = 2. * OVERDRIVE_TABLE_RANGE / OVERDRIVE_TABLE_SIZE;
+    const int center = OVERDRIVE_TABLE_SIZE / 2;
+
+    double sum = 0;
+
+    for (int i = 0; i <= OVERDRIVE_TABLE_SIZE; i++) {
+        f[i] = (float) overdrive(-OVERDRIVE_TABLE_RANGE + i * h);
+    }
+
+    F[center] = 0.f;
+
+    for (int dir = -1; dir <= 1; dir += 2) {
+        sum = 0;
+
+        for (int i = center; i != (dir > 0 ? OVERDRIVE_TABLE_SIZE : 0); i += dir) {
+            double x0 = -OVERDRIVE_TABLE_RANGE + i * h;
+            double d = dir * h / steps;
+            double s = overdrive(x0) + overdrive(x0 + dir * h);
+
+            for (int j = 1; j < steps; j++) {
+                s += (j & 1 ? 4 : 2) * overdrive(x0 + j * d);
+            }
+
+            sum += s * d / 3;
+            F[i + dir] = (float) sum;
+        }
+    }
+}
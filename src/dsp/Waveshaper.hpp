@@ -0,0 +1,609 @@
+#pragma once
+
+#include "DSPMath.hpp"
+
+#define ADAA_EPSILON 1e-3f          // below this input step the curve is evaluated at the midpoint
+#define OVERDRIVE_TABLE_SIZE 4096   // intervals of the overdrive antiderivative
+#define OVERDRIVE_TABLE_RANGE 64.f  // table covers -range..range, outside it continues linear
+#define RESHAPER_SERIES_LIMIT 0.04f // |4 - b^2| below this uses the series of the atan/atanh term
+
+using namespace rack;
+
+
+/**
+ * Waveshaper curves with first-order antiderivative antialiasing (ADAA)
+ *
+ * Every curve provides value() and antiderivative() from fast approximations in float, in a scalar and an SSE
+ * variant. ADAA outputs the slope of the antiderivative between two input samples instead of the curve itself,
+ * this is the curve averaged over the input step and suppresses aliasing by roughly 10 - 20 dB without
+ * oversampling. The price is half a sample of delay and a slight lowpass. Curve parameters are meant to be set
+ * at control rate, call update() of the ADAA stage afterwards.
+ */
+
+
+/**
+ * @brief shape1(): 2 (1 + k) x / (1 + k/2 |x|) with k = 2a / (1 - a)
+ */
+struct Shape1Curve {
+    float g = 2.f, c = 0.f, ic = 0.f; // gain, knee and 1 / knee
+
+
+    /**
+     * @brief Set amount
+     * @param a 0.05..0.95, smaller amounts lose precision in the antiderivative
+     */
+    inline void setAmount(float a) {
+        a = a < 0.05f ? 0.05f : (a > 0.95f ? 0.95f : a);
+
+        float k = 2.f * a / (1.f - a);
+
+        g = 2.f * (1.f + k);
+        c = 0.5f * k;
+        ic = 1.f / c;
+    }
+
+
+    /**
+     * @brief Curve value
+     * @param x
+     * @return
+     */
+    inline float value(float x) const {
+        return g * x / (1.f + c * fabsf(x));
+    }
+
+
+    /**
+     * @brief g / c * (|x| - log(1 + c |x|) / c)
+     * @param x
+     * @return
+     */
+    inline float antiderivative(float x) const {
+        float ax = fabsf(x);
+        return g * ic * (ax - fastLog(1.f + c * ax) * ic);
+    }
+};
+
+
+/**
+ * @brief SSE variant of Shape1Curve, every lane has its own amount
+ */
+struct Shape1CurveSSE {
+    __m128 g = _mm_set1_ps(2.f), c = _mm_setzero_ps(), ic = _mm_setzero_ps();
+
+
+    /**
+     * @brief Set amount
+     * @param a 0.05..0.95
+     */
+    inline void setAmount(__m128 a) {
+        a = _mm_min_ps(_mm_max_ps(a, _mm_set1_ps(0.05f)), _mm_set1_ps(0.95f));
+
+        __m128 k = _mm_div_ps(_mm_add_ps(a, a), _mm_sub_ps(_mm_set1_ps(1.f), a));
+
+        g = _mm_mul_ps(_mm_set1_ps(2.f), _mm_add_ps(_mm_set1_ps(1.f), k));
+        c = _mm_mul_ps(_mm_set1_ps(0.5f), k);
+        ic = _mm_div_ps(_mm_set1_ps(1.f), c);
+    }
+
+
+    /**
+     * @brief Curve value of all lanes
+     * @param x
+     * @return
+     */
+    inline __m128 value(__m128 x) const {
+        __m128 ax = _mm_andnot_ps(_mm_set1_ps(-0.f), x);
+        return _mm_div_ps(_mm_mul_ps(g, x), _mm_add_ps(_mm_set1_ps(1.f), _mm_mul_ps(c, ax)));
+    }
+
+
+    /**
+     * @brief Antiderivative of all lanes
+     * @param x
+     * @return
+     */
+    inline __m128 antiderivative(__m128 x) const {
+        __m128 ax = _mm_andnot_ps(_mm_set1_ps(-0.f), x);
+        __m128 l = fastLogSSE(_mm_add_ps(_mm_set1_ps(1.f), _mm_mul_ps(c, ax)));
+
+        return _mm_mul_ps(_mm_mul_ps(g, ic), _mm_sub_ps(ax, _mm_mul_ps(l, ic)));
+    }
+};
+
+
+/**
+ * @brief saturate(): linear up to a, above a + (1 - a) u / (1 + u^2) with u = (|x| - a) / (1 - a)
+ */
+struct SaturateCurve {
+    float a = 0.5f, ia = 2.f; // threshold and 1 / (1 - a)
+
+
+    /**
+     * @brief Set threshold
+     * @param a 0..0.99
+     */
+    inline void setAmount(float a) {
+        SaturateCurve::a = a < 0.f ? 0.f : (a > 0.99f ? 0.99f : a);
+        ia = 1.f / (1.f - SaturateCurve::a);
+    }
+
+
+    /**
+     * @brief Curve value
+     * @param x
+     * @return
+     */
+    inline float value(float x) const {
+        float ax = fabsf(x);
+        if (ax <= a) return x;
+
+        float u = (ax - a) * ia;
+        float y = a + (1.f - a) * u / (1.f + u * u);
+
+        return x < 0.f ? -y : y;
+    }
+
+
+    /**
+     * @brief x^2 / 2 up to a, above a^2 / 2 + a (|x| - a) + (1 - a)^2 / 2 log(1 + u^2)
+     * @param x
+     * @return
+     */
+    inline float antiderivative(float x) const {
+        float ax = fabsf(x);
+        if (ax <= a) return 0.5f * x * x;
+
+        float u = (ax - a) * ia;
+        float b = 1.f - a;
+
+        return a * (ax - 0.5f * a) + 0.5f * b * b * fastLog(1.f + u * u);
+    }
+};
+
+
+/**
+ * @brief SSE variant of SaturateCurve, every lane has its own threshold
+ */
+struct SaturateCurveSSE {
+    __m128 a = _mm_set1_ps(0.5f), ia = _mm_set1_ps(2.f);
+
+
+    /**
+     * @brief Set threshold
+     * @param a 0..0.99
+     */
+    inline void setAmount(__m128 a) {
+        SaturateCurveSSE::a = _mm_min_ps(_mm_max_ps(a, _mm_setzero_ps()), _mm_set1_ps(0.99f));
+        ia = _mm_div_ps(_mm_set1_ps(1.f), _mm_sub_ps(_mm_set1_ps(1.f), SaturateCurveSSE::a));
+    }
+
+
+    /**
+     * @brief Curve value of all lanes
+     * @param x
+     * @return
+     */
+    inline __m128 value(__m128 x) const {
+        const __m128 sign = _mm_set1_ps(-0.f);
+
+        __m128 ax = _mm_andnot_ps(sign, x);
+        __m128 linear = _mm_cmple_ps(ax, a);
+        __m128 u = _mm_mul_ps(_mm_sub_ps(ax, a), ia);
+        __m128 y = _mm_div_ps(_mm_mul_ps(_mm_sub_ps(_mm_set1_ps(1.f), a), u), _mm_add_ps(_mm_set1_ps(1.f), _mm_mul_ps(u, u)));
+
+        y = _mm_or_ps(_mm_add_ps(a, y), _mm_and_ps(x, sign));
+
+        return _mm_or_ps(_mm_and_ps(linear, x), _mm_andnot_ps(linear, y));
+    }
+
+
+    /**
+     * @brief Antiderivative of all lanes
+     * @param x
+     * @return
+     */
+    inline __m128 antiderivative(__m128 x) const {
+        const __m128 half = _mm_set1_ps(0.5f);
+
+        __m128 ax = _mm_andnot_ps(_mm_set1_ps(-0.f), x);
+        __m128 linear = _mm_cmple_ps(ax, a);
+        __m128 u = _mm_mul_ps(_mm_sub_ps(ax, a), ia);
+        __m128 b = _mm_sub_ps(_mm_set1_ps(1.f), a);
+
+        __m128 outer = _mm_mul_ps(a, _mm_sub_ps(ax, _mm_mul_ps(half, a)));
+        __m128 l = fastLogSSE(_mm_add_ps(_mm_set1_ps(1.f), _mm_mul_ps(u, u)));
+
+        outer = _mm_add_ps(outer, _mm_mul_ps(_mm_mul_ps(half, _mm_mul_ps(b, b)), l));
+
+        return _mm_or_ps(_mm_and_ps(linear, _mm_mul_ps(half, _mm_mul_ps(x, x))), _mm_andnot_ps(linear, outer));
+    }
+};
+
+
+/**
+ * @brief Antiderivative of overdrive(), which has no closed form, as cubic Hermite table of F and f
+ */
+struct OverdriveTable {
+    float F[OVERDRIVE_TABLE_SIZE + 1];
+    float f[OVERDRIVE_TABLE_SIZE + 1];
+
+    OverdriveTable();
+
+
+    /**
+     * @brief Interpolate antiderivative
+     * @param x
+     * @return
+     */
+    inline float lookup(float x) const {
+        const float h = 2.f * OVERDRIVE_TABLE_RANGE / OVERDRIVE_TABLE_SIZE;
+
+        float t = (x + OVERDRIVE_TABLE_RANGE) * (1.f / h);
+
+        if (t <= 0.f) return F[0] + f[0] * (x + OVERDRIVE_TABLE_RANGE);
+        if (t >= OVERDRIVE_TABLE_SIZE) return F[OVERDRIVE_TABLE_SIZE] + f[OVERDRIVE_TABLE_SIZE] * (x - OVERDRIVE_TABLE_RANGE);
+
+        int i = (int) t;
+        float u = t - i, u2 = u * u, u3 = u2 * u;
+
+        return F[i] * (2.f * u3 - 3.f * u2 + 1.f) + h * f[i] * (u3 - 2.f * u2 + u) +
+               F[i + 1] * (3.f * u2 - 2.f * u3) + h * f[i + 1] * (u3 - u2);
+    }
+};
+
+extern const OverdriveTable overdriveTable;
+
+
+/**
+ * @brief overdrive(): asymmetric tanh-like curve, evaluated with fastExp2() in the overflow-safe form
+ */
+struct OverdriveCurve {
+
+    /**
+     * @brief Same as overdrive(), numerator and denominator are scaled by exp(-|x'|)
+     * @param x
+     * @return
+     */
+    inline float value(float x) const {
+        const float log2e = 1.44269504f;
+
+        float v = x * 0.686306f;
+        float av = fabsf(v);
+        float a = 1.f + fastExp2(-0.75f * log2e * sqrtf(av));
+        float p = fastExp2(-2.f * log2e * av);
+
+        float num = v >= 0.f ? 1.f - fastExp2(-log2e * av * (a + 1.f)) : p - fastExp2(log2e * av * (a - 1.f));
+
+        return num / (1.f + p);
+    }
+
+
+    /**
+     * @brief Antiderivative from the table
+     * @param x
+     * @return
+     */
+    inline float antiderivative(float x) const {
+        return overdriveTable.lookup(x);
+    }
+};
+
+
+/**
+ * @brief SSE variant of OverdriveCurve, the table lookup runs per lane as SSE2 has no gather
+ */
+struct OverdriveCurveSSE {
+
+    /**
+     * @brief Curve value of all lanes
+     * @param x
+     * @return
+     */
+    inline __m128 value(__m128 x) const {
+        const __m128 log2e = _mm_set1_ps(1.44269504f);
+        const __m128 one = _mm_set1_ps(1.f);
+
+        __m128 v = _mm_mul_ps(x, _mm_set1_ps(0.686306f));
+        __m128 av = _mm_andnot_ps(_mm_set1_ps(-0.f), v);
+        __m128 a = _mm_add_ps(one, fastExp2SSE(_mm_mul_ps(_mm_set1_ps(-0.75f * 1.44269504f), _mm_sqrt_ps(av))));
+        __m128 p = fastExp2SSE(_mm_mul_ps(_mm_set1_ps(-2.f * 1.44269504f), av));
+        __m128 lav = _mm_mul_ps(log2e, av);
+
+        __m128 pos = _mm_sub_ps(one, fastExp2SSE(_mm_mul_ps(_mm_sub_ps(_mm_setzero_ps(), lav), _mm_add_ps(a, one))));
+        __m128 neg = _mm_sub_ps(p, fastExp2SSE(_mm_mul_ps(lav, _mm_sub_ps(a, one))));
+        __m128 positive = _mm_cmpge_ps(v, _mm_setzero_ps());
+
+        __m128 num = _mm_or_ps(_mm_and_ps(positive, pos), _mm_andnot_ps(positive, neg));
+
+        return _mm_div_ps(num, _mm_add_ps(one, p));
+    }
+
+
+    /**
+     * @brief Antiderivative of all lanes, one table lookup per lane
+     * @param x
+     * @return
+     */
+    inline __m128 antiderivative(__m128 x) const {
+        alignas(16) float lanes[4];
+
+        _mm_store_ps(lanes, x);
+
+        for (int i = 0; i < 4; i++) lanes[i] = overdriveTable.lookup(lanes[i]);
+
+        return _mm_load_ps(lanes);
+    }
+};
+
+
+/**
+ * @brief ReShaper curve x (|x| + a) / (x^2 + (a - 1) |x| + 1)
+ *
+ * With b = a - 1 the curve is 1 + (x - 1) / Q for x >= 0 with Q = x^2 + b x + 1, its antiderivative
+ * x + log(Q) / 2 - (1 + b / 2) I(x). The integral I of 1 / Q is an atan for b < 2 and an atanh for b > 2,
+ * both written relative to I(0) as (2 / s) atan(s x / (2 + b x)) with s^2 = 4 - b^2, so the closed forms
+ * stay well conditioned. Close to b = 2 the series of atan(z) / z is used.
+ */
+struct ReShaperCurve {
+    float a = 1.f, b = 0.f;
+    float q0 = 4.f;              // s^2 = 4 - b^2
+    float is = 0.5f;             // 1 / s or 1 / r with r^2 = b^2 - 4
+    float bpr = 0.f, fbpr = 0.f; // b + r and 4 / (b + r)
+    float k = 1.f;               // 1 + b / 2
+
+
+    /**
+     * @brief Set amount
+     * @param a 1..50
+     */
+    inline void setAmount(float a) {
+        ReShaperCurve::a = a < 1.f ? 1.f : a;
+        b = ReShaperCurve::a - 1.f;
+        q0 = 4.f - b * b;
+        k = 1.f + 0.5f * b;
+
+        if (q0 > RESHAPER_SERIES_LIMIT) {
+            is = 1.f / sqrtf(q0);
+        } else if (q0 < -RESHAPER_SERIES_LIMIT) {
+            float r = sqrtf(-q0);
+
+            is = 1.f / r;
+            bpr = b + r;
+            fbpr = 4.f / bpr;
+        }
+    }
+
+
+    /**
+     * @brief Set only the coefficients of value(), antiderivative() needs setAmount()
+     * @param a 1..50
+     */
+    inline void setValueAmount(float a) {
+        ReShaperCurve::a = a < 1.f ? 1.f : a;
+        b = ReShaperCurve::a - 1.f;
+    }
+
+
+    /**
+     * @brief Curve value
+     * @param x
+     * @return
+     */
+    inline float value(float x) const {
+        float ax = fabsf(x);
+        return x * (ax + a) / (x * x + b * ax + 1.f);
+    }
+
+
+    /**
+     * @brief Antiderivative, F(0) = 0
+     * @param x
+     * @return
+     */
+    inline float antiderivative(float x) const {
+        float y = fabsf(x);
+        float i;
+
+        if (q0 > RESHAPER_SERIES_LIMIT) {
+            float s = q0 * is;
+            i = 2.f * is * fastAtan(s * y / (2.f + b * y));
+        } else if (q0 < -RESHAPER_SERIES_LIMIT) {
+            i = is * fastLog((2.f + bpr * y) / (2.f + fbpr * y));
+        } else {
+            float w = y / (2.f + b * y);
+            float q = q0 * w * w;
+
+            i = 2.f * w * (1.f - q * (1.f / 3.f) + q * q * 0.2f);
+        }
+
+        return y + 0.5f * fastLog(1.f + b * y + y * y) - k * i;
+    }
+};
+
+
+/**
+ * @brief SSE variant of ReShaperCurve, every lane has its own amount
+ *
+ * Only the forms of I used by at least one lane are computed.
+ */
+struct ReShaperCurveSSE {
+    __m128 a = _mm_set1_ps(1.f), b = _mm_setzero_ps(), q0 = _mm_set1_ps(4.f);
+    __m128 s = _mm_set1_ps(2.f), is = _mm_set1_ps(0.5f), bpr = _mm_setzero_ps(), fbpr = _mm_setzero_ps();
+    __m128 k = _mm_set1_ps(1.f);
+    __m128 atanLanes = _mm_castsi128_ps(_mm_set1_epi32(-1)), logLanes = _mm_setzero_ps();
+    int forms = 1; // bit 0 atan, bit 1 atanh, bit 2 series
+
+
+    /**
+     * @brief Set amount
+     * @param a 1..50
+     */
+    inline void setAmount(__m128 a) {
+        const __m128 one = _mm_set1_ps(1.f);
+        const __m128 limit = _mm_set1_ps(RESHAPER_SERIES_LIMIT);
+
+        ReShaperCurveSSE::a = _mm_max_ps(a, one);
+        b = _mm_sub_ps(ReShaperCurveSSE::a, one);
+        q0 = _mm_sub_ps(_mm_set1_ps(4.f), _mm_mul_ps(b, b));
+        k = _mm_add_ps(one, _mm_mul_ps(_mm_set1_ps(0.5f), b));
+
+        atanLanes = _mm_cmpgt_ps(q0, limit);
+        logLanes = _mm_cmplt_ps(q0, _mm_sub_ps(_mm_setzero_ps(), limit));
+
+        /* s or r, the square root of |q0| */
+        __m128 r = _mm_sqrt_ps(_mm_max_ps(_mm_andnot_ps(_mm_set1_ps(-0.f), q0), limit));
+
+        s = r;
+        is = _mm_div_ps(one, r);
+        bpr = _mm_add_ps(b, r);
+        fbpr = _mm_div_ps(_mm_set1_ps(4.f), bpr);
+
+        int atanMask = _mm_movemask_ps(atanLanes), logMask = _mm_movemask_ps(logLanes);
+
+        forms = (atanMask ? 1 : 0) | (logMask ? 2 : 0) | ((atanMask | logMask) != 0xF ? 4 : 0);
+    }
+
+
+    /**
+     * @brief Set only the coefficients of value(), antiderivative() needs setAmount()
+     * @param a 1..50
+     */
+    inline void setValueAmount(__m128 a) {
+        ReShaperCurveSSE::a = _mm_max_ps(a, _mm_set1_ps(1.f));
+        b = _mm_sub_ps(ReShaperCurveSSE::a, _mm_set1_ps(1.f));
+    }
+
+
+    /**
+     * @brief Curve value of all lanes, with fastRcpSSE() instead of a division
+     * @param x
+     * @return
+     */
+    inline __m128 value(__m128 x) const {
+        __m128 ax = _mm_andnot_ps(_mm_set1_ps(-0.f), x);
+        __m128 num = _mm_mul_ps(x, _mm_add_ps(ax, a));
+        __m128 den = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(b, ax)), _mm_set1_ps(1.f));
+
+        /* the denominator is at least 1, no guard against zero needed */
+        return _mm_mul_ps(num, fastRcpSSE(den));
+    }
+
+
+    /**
+     * @brief Antiderivative of all lanes
+     * @param x
+     * @return
+     */
+    inline __m128 antiderivative(__m128 x) const {
+        const __m128 one = _mm_set1_ps(1.f);
+        const __m128 two = _mm_set1_ps(2.f);
+
+        __m128 y = _mm_andnot_ps(_mm_set1_ps(-0.f), x);
+        __m128 d = _mm_add_ps(two, _mm_mul_ps(b, y));
+        __m128 i = _mm_setzero_ps();
+
+        if (forms & 1) {
+            __m128 t = fastAtanSSE(_mm_div_ps(_mm_mul_ps(s, y), d));
+            i = _mm_and_ps(atanLanes, _mm_mul_ps(_mm_mul_ps(two, is), t));
+        }
+
+        if (forms & 2) {
+            __m128 ratio = _mm_div_ps(_mm_add_ps(two, _mm_mul_ps(bpr, y)), _mm_add_ps(two, _mm_mul_ps(fbpr, y)));
+            i = _mm_or_ps(i, _mm_and_ps(logLanes, _mm_mul_ps(is, fastLogSSE(ratio))));
+        }
+
+        if (forms & 4) {
+            __m128 w = _mm_div_ps(y, d);
+            __m128 q = _mm_mul_ps(q0, _mm_mul_ps(w, w));
+            __m128 p = _mm_add_ps(_mm_sub_ps(one, _mm_mul_ps(q, _mm_set1_ps(1.f / 3.f))),
+                                  _mm_mul_ps(_mm_mul_ps(q, q), _mm_set1_ps(0.2f)));
+
+            i = _mm_or_ps(i, _mm_andnot_ps(_mm_or_ps(atanLanes, logLanes), _mm_mul_ps(_mm_mul_ps(two, w), p)));
+        }
+
+        __m128 q = _mm_add_ps(_mm_add_ps(one, _mm_mul_ps(b, y)), _mm_mul_ps(y, y));
+
+        return _mm_sub_ps(_mm_add_ps(y, _mm_mul_ps(_mm_set1_ps(0.5f), fastLogSSE(q))), _mm_mul_ps(k, i));
+    }
+};
+
+
+/**
+ * @brief First-order ADAA stage for one channel
+ */
+template<typename CURVE>
+struct ADAA {
+    CURVE curve;
+    float x1 = 0.f, F1 = 0.f;
+
+
+    /**
+     * @brief Recompute the stored antiderivative, call after changing the curve parameters
+     */
+    inline void update() {
+        F1 = curve.antiderivative(x1);
+    }
+
+
+    /**
+     * @brief Shape next sample
+     * @param x
+     * @return
+     */
+    inline float process(float x) {
+        float F = curve.antiderivative(x);
+        float dx = x - x1;
+
+        /* the difference quotient is ill-conditioned for small steps, the midpoint is exact enough there */
+        float y = (dx > ADAA_EPSILON || dx < -ADAA_EPSILON) ? (F - F1) / dx : curve.value(0.5f * (x + x1));
+
+        x1 = x;
+        F1 = F;
+
+        return y;
+    }
+};
+
+
+/**
+ * @brief First-order ADAA stage for four channels
+ */
+template<typename CURVE>
+struct ADAASSE {
+    CURVE curve;
+    __m128 x1 = _mm_setzero_ps(), F1 = _mm_setzero_ps();
+
+
+    /**
+     * @brief Recompute the stored antiderivative, call after changing the curve parameters
+     */
+    inline void update() {
+        F1 = curve.antiderivative(x1);
+    }
+
+
+    /**
+     * @brief Shape next sample of all channels
+     * @param x
+     * @return
+     */
+    inline __m128 process(__m128 x) {
+        __m128 F = curve.antiderivative(x);
+        __m128 dx = _mm_sub_ps(x, x1);
+        __m128 step = _mm_cmpgt_ps(_mm_andnot_ps(_mm_set1_ps(-0.f), dx), _mm_set1_ps(ADAA_EPSILON));
+
+        /* lanes with small steps are masked out, their quotient may be inf or NaN */
+        __m128 y = _mm_and_ps(step, _mm_div_ps(_mm_sub_ps(F, F1), dx));
+
+        if (_mm_movemask_ps(step) != 0xF) {
+            __m128 mid = curve.value(_mm_mul_ps(_mm_set1_ps(0.5f), _mm_add_ps(x, x1)));
+            y = _mm_or_ps(y, _mm_andnot_ps(step, mid));
+        }
+
+        x1 = x;
+        F1 = F;
+
+        return y;
+    }
+};
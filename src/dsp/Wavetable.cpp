@@ -0,0 +1,376 @@
+#include <algorithm>
+#include <cstring>
+#include "Wavetable.hpp"
+
+#if defined(ARCH_WIN) || defined(_WIN32)
+#include <cstdio>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace rack;
+
+
+std::mutex WavetableCache::mutex;
+std::map<std::string, std::weak_ptr<const Wavetable>> WavetableCache::tables;
+
+
+/**
+ * @brief Read-only view of a whole file, memory mapped where available
+ */
+struct MappedFile {
+    const uint8_t *data = nullptr;
+    size_t size = 0;
+
+#if defined(ARCH_WIN) || defined(_WIN32)
+    /* no mmap, the file is read into memory */
+    std::vector<uint8_t> buffer;
+
+
+    /**
+     * @brief Read file
+     * @param path
+     */
+    explicit MappedFile(const std::string &path) {
+        FILE *f = fopen(path.c_str(), "rb");
+        if (!f) return;
+
+        fseek(f, 0, SEEK_END);
+        long len = ftell(f);
+        fseek(f, 0, SEEK_SET);
+
+        if (len > 0) {
+            buffer.resize((size_t) len);
+
+            if (fread(buffer.data(), 1, buffer.size(), f) == buffer.size()) {
+                data = buffer.data();
+                size = buffer.size();
+            }
+        }
+
+        fclose(f);
+    }
+
+
+    ~MappedFile() {}
+#else
+
+
+    /**
+     * @brief Map file
+     * @param path
+     */
+    explicit MappedFile(const std::string &path) {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) return;
+
+        struct stat st;
+
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            void *p = mmap(nullptr, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+            if (p != MAP_FAILED) {
+                data = (const uint8_t *) p;
+                size = (size_t) st.st_size;
+            }
+        }
+
+        /* the mapping stays valid without the descriptor */
+        close(fd);
+    }
+
+
+    ~MappedFile() {
+        if (data) munmap((void *) data, size);
+    }
+#endif
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+};
+
+
+/**
+ * @brief Read little-endian 16 bit value
+ * @param p
+ * @return
+ */
+static inline uint32_t readLE16(const uint8_t *p) {
+    return (uint32_t) p[0] | ((uint32_t) p[1] << 8);
+}
+
+
+/**
+ * @brief Read little-endian 32 bit value
+ * @param p
+ * @return
+ */
+static inline uint32_t readLE32(const uint8_t *p) {
+    return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+
+/**
+ * @brief In-place radix-2 complex FFT, only used while loading
+ * @param re Real parts
+ * @param im Imaginary parts
+ * @param bits log2 of the size
+ * @param inverse Inverse transform, not scaled
+ */
+static void fft(double *re, double *im, int bits, bool inverse) {
+    int n = 1 << bits;
+
+    /* bit reversal permutation */
+    for (int i = 1, j = 0; i < n; i++) {
+        int bit = n >> 1;
+
+        for (; j & bit; bit >>= 1) j ^= bit;
+        j ^= bit;
+
+        if (i < j) {
+            std::swap(re[i], re[j]);
+            std::swap(im[i], im[j]);
+        }
+    }
+
+    for (int len = 2; len <= n; len <<= 1) {
+        double w = (inverse ? 2 : -2) * M_PI / len;
+
+        for (int k = 0; k < len / 2; k++) {
+            double c = cos(w * k), s = sin(w * k);
+
+            for (int i = k; i < n; i += len) {
+                int j = i + len / 2;
+
+                double tr = re[j] * c - im[j] * s;
+                double ti = re[j] * s + im[j] * c;
+
+                re[j] = re[i] - tr;
+                im[j] = im[i] - ti;
+                re[i] += tr;
+                im[i] += ti;
+            }
+        }
+    }
+}
+
+
+/**
+ * @brief Build all mip levels from raw samples
+ *
+ * Files shorter than one frame are taken as a single cycle and stretched to WAVETABLE_FRAME_SIZE,
+ * longer files are cut into frames of WAVETABLE_FRAME_SIZE samples.
+ * @param samples Mono samples
+ * @param count Number of samples
+ * @return false if there is nothing to build from
+ */
+bool Wavetable::build(const float *samples, int count) {
+    if (count < 2) return false;
+
+    frames = count < WAVETABLE_FRAME_SIZE ? 1 : count / WAVETABLE_FRAME_SIZE;
+    if (frames > WAVETABLE_MAX_FRAMES) frames = WAVETABLE_MAX_FRAMES;
+
+    for (int k = 0; k < WAVETABLE_MIP_LEVELS; k++) {
+        /* 8 samples per cycle of the highest harmonic: (FRAME_SIZE / 2 >> k) * 8 */
+        int b = WAVETABLE_FRAME_BITS + 2 - k;
+
+        bits[k] = b > WAVETABLE_FRAME_BITS ? WAVETABLE_FRAME_BITS : (b < WAVETABLE_MIN_BITS ? WAVETABLE_MIN_BITS : b);
+        data[k].assign((size_t) frames * ((1 << bits[k]) + 1), 0.f);
+    }
+
+    std::vector<double> specRe(WAVETABLE_FRAME_SIZE), specIm(WAVETABLE_FRAME_SIZE);
+    std::vector<double> re(WAVETABLE_FRAME_SIZE), im(WAVETABLE_FRAME_SIZE);
+
+    for (int f = 0; f < frames; f++) {
+        for (int i = 0; i < WAVETABLE_FRAME_SIZE; i++) {
+            if (count < WAVETABLE_FRAME_SIZE) {
+                /* stretch a single short cycle */
+                float x = (float) i * count / WAVETABLE_FRAME_SIZE;
+                int j = (int) x;
+                float s1 = samples[j], s2 = samples[(j + 1) % count];
+
+                specRe[i] = s1 + (s2 - s1) * (x - j);
+            } else {
+                specRe[i] = samples[f * WAVETABLE_FRAME_SIZE + i];
+            }
+
+            specIm[i] = 0;
+        }
+
+        fft(specRe.data(), specIm.data(), WAVETABLE_FRAME_BITS, false);
+
+        for (int k = 0; k < WAVETABLE_MIP_LEVELS; k++) {
+            int n = 1 << bits[k];
+            int harmonics = (WAVETABLE_FRAME_SIZE / 2) >> k;
+
+            std::fill(re.begin(), re.begin() + n, 0.);
+            std::fill(im.begin(), im.begin() + n, 0.);
+
+            /* keep harmonics 1..harmonics, DC is removed */
+            for (int h = 1; h <= harmonics && h <= n / 2; h++) {
+                re[h] = specRe[h];
+                im[h] = specIm[h];
+
+                if (h < n / 2) {
+                    re[n - h] = specRe[h];
+                    im[n - h] = -specIm[h];
+                }
+            }
+
+            fft(re.data(), im.data(), bits[k], true);
+
+            float *dst = &data[k][f * (n + 1)];
+
+            for (int i = 0; i < n; i++) {
+                dst[i] = (float) (re[i] / WAVETABLE_FRAME_SIZE);
+            }
+
+            dst[n] = dst[0];
+        }
+    }
+
+    /* normalize all levels by the peak of the first one, frames keep their relative level */
+    float peak = 0.f;
+
+    for (float x : data[0]) {
+        if (fabsf(x) > peak) peak = fabsf(x);
+    }
+
+    if (peak > 0.f) {
+        for (int k = 0; k < WAVETABLE_MIP_LEVELS; k++) {
+            for (float &x : data[k]) x /= peak;
+        }
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief Load a WAV file, PCM with 8, 16, 24 or 32 bit or 32 bit float, only the first channel is used
+ * @param path
+ * @return false if the file can not be read or has an unsupported format
+ */
+bool Wavetable::loadWAV(const std::string &path) {
+    MappedFile file(path);
+
+    const uint8_t *p = file.data;
+    size_t size = file.size;
+
+    if (!p || size < 12 || memcmp(p, "RIFF", 4) != 0 || memcmp(p + 8, "WAVE", 4) != 0) return false;
+
+    int format = 0, channels = 0, depth = 0;
+    const uint8_t *samples = nullptr;
+    size_t bytes = 0;
+
+    /* walk the chunks, every chunk is padded to an even size */
+    for (size_t pos = 12; pos + 8 <= size;) {
+        const uint8_t *chunk = p + pos;
+        size_t len = readLE32(chunk + 4);
+
+        if (len > size - pos - 8) len = size - pos - 8;
+
+        if (memcmp(chunk, "fmt ", 4) == 0 && len >= 16) {
+            format = readLE16(chunk + 8);
+            channels = readLE16(chunk + 10);
+            depth = readLE16(chunk + 22);
+
+            /* WAVE_FORMAT_EXTENSIBLE, the format is in the sub-format GUID */
+            if (format == 0xFFFE && len >= 40) format = readLE16(chunk + 32);
+        } else if (memcmp(chunk, "data", 4) == 0) {
+            samples = chunk + 8;
+            bytes = len;
+        }
+
+        pos += 8 + len + (len & 1);
+    }
+
+    bool pcm = format == 1 && (depth == 8 || depth == 16 || depth == 24 || depth == 32);
+    bool ieee = format == 3 && depth == 32;
+
+    if (!samples || channels < 1 || !(pcm || ieee)) return false;
+
+    size_t stride = (size_t) channels * (depth / 8);
+    int count = (int) (bytes / stride);
+
+    /* limit to the frames that are used */
+    if (count > WAVETABLE_FRAME_SIZE * WAVETABLE_MAX_FRAMES) count = WAVETABLE_FRAME_SIZE * WAVETABLE_MAX_FRAMES;
+
+    std::vector<float> mono((size_t) count);
+
+    for (int i = 0; i < count; i++) {
+        const uint8_t *s = samples + i * stride;
+
+        switch (depth) {
+            case 8:
+                mono[i] = (s[0] - 128) * (1.f / 128.f);
+                break;
+            case 16:
+                mono[i] = (int16_t) readLE16(s) * (1.f / 32768.f);
+                break;
+            case 24:
+                mono[i] = (int32_t) (((uint32_t) s[0] << 8) | ((uint32_t) s[1] << 16) | ((uint32_t) s[2] << 24)) *
+                          (1.f / 2147483648.f);
+                break;
+            default:
+                if (ieee) {
+                    uint32_t u = readLE32(s);
+                    float x;
+
+                    memcpy(&x, &u, sizeof(x));
+                    mono[i] = x;
+                } else {
+                    mono[i] = (int32_t) readLE32(s) * (1.f / 2147483648.f);
+                }
+        }
+    }
+
+    Wavetable::path = path;
+
+    return build(mono.data(), count);
+}
+
+
+/**
+ * @brief Get a wavetable, it is only read from disk if no other oscillator uses it already
+ * @param path Path of a WAV file
+ * @return Shared table or nullptr if the file can not be loaded
+ */
+std::shared_ptr<const Wavetable> WavetableCache::load(const std::string &path) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    std::shared_ptr<const Wavetable> table = tables[path].lock();
+    if (table) return table;
+
+    std::shared_ptr<Wavetable> loaded = std::make_shared<Wavetable>();
+
+    if (!loaded->loadWAV(path)) {
+        tables.erase(path);
+        warn("Unable to load wavetable %s", path.c_str());
+
+        return nullptr;
+    }
+
+    tables[path] = loaded;
+
+    return loaded;
+}
+
+
+/**
+ * @brief Number of tables currently in memory
+ * @return
+ */
+int WavetableCache::size() {
+    std::lock_guard<std::mutex> lock(mutex);
+    int n = 0;
+
+    for (auto &entry : tables) {
+        if (!entry.second.expired()) n++;
+    }
+
+    return n;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "DSPMath.hpp"
+
+#define WAVETABLE_FRAME_SIZE 2048   // samples per frame in the file, 2^WAVETABLE_FRAME_BITS
+#define WAVETABLE_FRAME_BITS 11
+#define WAVETABLE_MAX_FRAMES 256
+#define WAVETABLE_MIP_LEVELS 11     // harmonics halve with every level, the last one holds the fundamental
+#define WAVETABLE_MIN_BITS 5        // smallest mip level size, 32 samples
+
+using namespace rack;
+
+
+/**
+ * @brief Band-limited mip levels of a user wavetable, read-only after loading
+ *
+ * Level k holds the harmonics 1..(WAVETABLE_FRAME_SIZE / 2 >> k) of every frame. The size of a level is
+ * eight times its highest harmonic, but at most WAVETABLE_FRAME_SIZE, so the linear interpolation of the
+ * upper levels is as good as the one of the first and a table of 256 frames takes about 8.4 MB.
+ * Every frame has one guard sample which repeats the first one, so the interpolation needs no wrap.
+ */
+struct Wavetable {
+    std::string path;
+    int frames = 0;
+
+    int bits[WAVETABLE_MIP_LEVELS];           // log2 of the frame size per level
+    std::vector<float> data[WAVETABLE_MIP_LEVELS];
+
+
+    /**
+     * @brief Get a frame of a mip level
+     * @param level 0..WAVETABLE_MIP_LEVELS - 1
+     * @param frame 0..frames - 1
+     * @return (1 << bits[level]) + 1 samples
+     */
+    inline const float *getFrame(int level, int frame) const {
+        return &data[level][frame * ((1 << bits[level]) + 1)];
+    }
+
+
+    bool build(const float *samples, int count);
+    bool loadWAV(const std::string &path);
+};
+
+
+/**
+ * @brief Process-wide cache of loaded wavetables, keyed by file path
+ *
+ * All oscillators share one read-only copy per file. Entries hold weak references only, a table is freed
+ * with the last oscillator using it and loaded again on the next request.
+ */
+struct WavetableCache {
+    static std::shared_ptr<const Wavetable> load(const std::string &path);
+    static int size();
+
+private:
+    static std::mutex mutex;
+    static std::map<std::string, std::weak_ptr<const Wavetable>> tables;
+};
@@ -0,0 +1,256 @@
+#include "DSPMath.hpp"
+#include "WavetableOscillator.hpp"
+
+using namespace rack;
+
+
+/**
+ * @brief Set oscillator state back, the table is kept
+ */
+void WavetableOscillator::reset() {
+    freq = 0.f;
+    position = 0.f;
+    phase = 0;
+    incr = 0;
+    level = 0;
+    fmHz = 0.f;
+    fmMode = FM_MODE_LINEAR;
+    out = 0.f;
+
+    pitch = PitchCache();
+
+    /* force recalculation of variables */
+    setFrequency(NOTE_C4);
+}
+
+
+/**
+ * @brief Default constructor
+ */
+WavetableOscillator::WavetableOscillator() : changed(false) {
+    sr = engineGetSampleRate();
+    isr = 1.f / sr;
+
+    reset();
+}
+
+
+/**
+ * @brief Default destructor
+ */
+WavetableOscillator::~WavetableOscillator() {}
+
+
+/**
+ * @brief Hand over a new table, called outside of the audio thread
+ * @param table Shared table from WavetableCache, nullptr for silence
+ */
+void WavetableOscillator::setTable(std::shared_ptr<const Wavetable> table) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    /* releases the table swapped out by the last hand over */
+    pending = table;
+    changed = true;
+}
+
+
+/**
+ * @brief Get sample rate
+ * @return
+ */
+float WavetableOscillator::getSampleRate() const {
+    return sr;
+}
+
+
+/**
+ * @brief Set sample rate, recomputes the increment and the mip level on change
+ * @param sr
+ */
+void WavetableOscillator::setSampleRate(float sr) {
+    if (WavetableOscillator::sr != sr) {
+        WavetableOscillator::sr = sr;
+        isr = 1.f / sr;
+
+        invalidate();
+    }
+}
+
+
+/**
+ * @brief Get current frequency
+ * @return
+ */
+float WavetableOscillator::getFrequency() const {
+    return freq;
+}
+
+
+/**
+ * @brief Set frequency
+ * @param freq
+ */
+void WavetableOscillator::setFrequency(float freq) {
+    /* just set if frequency differs from old value */
+    if (WavetableOscillator::freq != freq) {
+        WavetableOscillator::freq = freq;
+
+        /* force recalculation of variables */
+        invalidate();
+    }
+}
+
+
+/**
+ * @brief Get frame position
+ * @return
+ */
+float WavetableOscillator::getPosition() const {
+    return position;
+}
+
+
+/**
+ * @brief Set frame position
+ * @param position 0..1 from the first to the last frame
+ */
+void WavetableOscillator::setPosition(float position) {
+    WavetableOscillator::position = position < 0.f ? 0.f : (position > 1.f ? 1.f : position);
+}
+
+
+/**
+ * @brief Get FM mode
+ * @return FM_MODE_LINEAR or FM_MODE_THROUGH_ZERO
+ */
+int WavetableOscillator::getFMMode() const {
+    return fmMode;
+}
+
+
+/**
+ * @brief Set FM mode, through-zero lets the modulated frequency go negative and run the phase backwards
+ * @param fmMode FM_MODE_LINEAR or FM_MODE_THROUGH_ZERO
+ */
+void WavetableOscillator::setFMMode(int fmMode) {
+    if (WavetableOscillator::fmMode != fmMode) {
+        WavetableOscillator::fmMode = fmMode;
+
+        /* force recalculation of variables */
+        invalidate();
+    }
+}
+
+
+/**
+ * @brief Current output
+ * @return
+ */
+float WavetableOscillator::getOut() const {
+    return out;
+}
+
+
+/**
+ * @brief Process wavetable oscillator
+ */
+void WavetableOscillator::proccess() {
+    /* pick up a new table, never blocks, a busy lock is retried with the next sample */
+    if (changed && mutex.try_lock()) {
+        table.swap(pending);
+        changed = false;
+        mutex.unlock();
+    }
+
+    /* phase locked loop, wraps on overflow */
+    phase += (uint32_t) incr;
+
+    if (!table) {
+        out = 0.f;
+        return;
+    }
+
+    /* frames to morph between */
+    float x = position * (table->frames - 1);
+    int f1 = (int) x;
+    int f2 = f1 + 1 < table->frames ? f1 + 1 : f1;
+    float morph = x - f1;
+
+    const float *a = table->getFrame(level, f1);
+    const float *b = table->getFrame(level, f2);
+
+    /* integer part of the phase selects the sample, the next 24 bit interpolate */
+    int bits = table->bits[level];
+    uint32_t i = phase >> (32 - bits);
+    float t = (int32_t) ((phase << bits) >> 8) * (1.f / 16777216.f);
+
+    float sa = a[i] + (a[i + 1] - a[i]) * t;
+    float sb = b[i] + (b[i + 1] - b[i]) * t;
+
+    out = (sa + (sb - sa) * morph) * WAVETABLE_LEVEL;
+}
+
+
+/**
+ * @brief ReCompute basic parameter
+ */
+void WavetableOscillator::invalidate() {
+    hzIncrFixed = 4294967296.f * isr;
+    fmax = sr * 0.45f;
+    nyquist = sr * 0.5f;
+
+    updateIncrement();
+}
+
+
+/**
+ * @brief Compute the phase increment and the mip level of the modulated frequency
+ */
+void WavetableOscillator::updateIncrement() {
+    float f = getModulatedFrequency();
+
+    incr = (int32_t) (f * hzIncrFixed);
+
+    /* highest harmonic of level k is (FRAME_SIZE / 2 >> k), keep it below nyquist */
+    float top = fabsf(f) * (WAVETABLE_FRAME_SIZE / 2);
+
+    level = 0;
+
+    while (level < WAVETABLE_MIP_LEVELS - 1 && top > nyquist) {
+        top *= 0.5f;
+        level++;
+    }
+}
+
+
+/**
+ * @brief Get frequency with FM applied, limited to the range of the FM mode
+ * @return
+ */
+float WavetableOscillator::getModulatedFrequency() const {
+    return clampModulated(freq + fmHz, fmax, fmMode);
+}
+
+
+/**
+ * @brief Audio rate frequency modulation, sets the phase increment directly
+ * @param fm Frequency offset in Hz
+ */
+void WavetableOscillator::setFM(float fm) {
+    if (fmHz == fm) return;
+
+    fmHz = fm;
+
+    updateIncrement();
+}
+
+
+/**
+ * @brief Translate from control voltage to frequency
+ * @param cv ControlVoltage from MIDI2CV
+ * @param fm Frequency offset in Hz, for audio rate FM use setFM()
+ * @param oct Octave
+ */
+void WavetableOscillator::updatePitch(float cv, float fm, float tune, float oct) {
+    setFrequency(pitch.hz(cv, tune, oct) + fm);
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include "Wavetable.hpp"
+#include "Oscillator.hpp"
+
+#define WAVETABLE_LEVEL 5.f // peak output level
+
+using namespace rack;
+
+
+/**
+ * @brief Oscillator playing a shared user wavetable
+ *
+ * The mip level is chosen from the modulated frequency so that no harmonic exceeds nyquist, the position
+ * morphs linearly between adjacent frames. Tables are handed over from the UI thread with setTable() and
+ * picked up by proccess() without waiting, the previous table is released by the next setTable() call, so
+ * the audio thread never frees memory.
+ */
+struct WavetableOscillator {
+    float freq;      // oscillator frequency
+    float position;  // frame position 0..1
+    uint32_t phase;  // current phase, one cycle is 2^32
+    int32_t incr;    // current phase increment, negative while running backwards
+    int level;       // current mip level
+    float fmHz;      // audio rate frequency modulation in Hz
+    int fmMode;      // linear or through-zero FM
+    float sr, isr;   // sample rate and its reciprocal
+    float hzIncrFixed; // phase increment of 1 Hz, cached from the sample rate
+    float fmax;      // highest modulated frequency
+    float nyquist;   // highest harmonic of the mip levels
+    float out;
+
+    /* frequency of the last pitch CV, octave and tune */
+    PitchCache pitch;
+
+    /* table used by proccess() and the one handed over by setTable() */
+    std::shared_ptr<const Wavetable> table;
+    std::shared_ptr<const Wavetable> pending;
+    std::mutex mutex;
+    std::atomic<bool> changed;
+
+    WavetableOscillator();
+    ~WavetableOscillator();
+
+    /**
+     * @brief Proccess next sample for output
+     */
+    void proccess();
+
+
+    /**
+     * @brief ReCompute states on change
+     */
+    void invalidate();
+
+
+    /**
+     * @brief Reset oscillator
+     */
+    void reset();
+
+
+    void updatePitch(float cv, float fm, float tune, float oct);
+    void setFM(float fm);
+    float getModulatedFrequency() const;
+    void updateIncrement();
+
+    /* common getter and setter */
+    float getSampleRate() const;
+    void setSampleRate(float sr);
+    float getFrequency() const;
+    void setFrequency(float freq);
+    float getPosition() const;
+    void setPosition(float position);
+    int getFMMode() const;
+    void setFMMode(int fmMode);
+    void setTable(std::shared_ptr<const Wavetable> table);
+
+    float getOut() const;
+};
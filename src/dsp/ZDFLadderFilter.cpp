@@ -0,0 +1,310 @@
+#include "ZDFLadderFilter.hpp"
+
+using namespace rack;
+
+
+/**
+ * @brief Constructor
+ */
+ZDFLadderFilter::ZDFLadderFilter() {
+    s1 = s2 = s3 = s4 = 0.f;
+    freqHz = 20.f;
+    frequency = resonance = drive = 0.f;
+    in = lpOut = bpOut = hpOut = 0.f;
+
+    os.setFactor(ZDF_OVERSAMPLE);
+    invalidate();
+}
+
+
+/**
+ * @brief Compute TPT coefficients from cutoff, resonance and drive
+ */
+void ZDFLadderFilter::invalidate() {
+    float fs = sr * os.factor;
+    float fc = fminf(freqHz, fs * 0.45f);
+
+    // bilinear transform with prewarping keeps the cutoff in tune up to nyquist
+    float g = tanf((float) M_PI * fc / fs);
+
+    G = g / (1.f + g);
+    h = 1.f - G;
+
+    // same resonance curve as the classic core, 1.5 maps to the edge of self-oscillation
+    k = LadderFilter::computeResExp(resonance, drive) * (4.f / 1.5f);
+    norm = 1.f / (1.f + k * G * G * G * G);
+
+    gain = 1.f + 3.f * drive;
+}
+
+
+/**
+ * @brief Calculate new sample
+ */
+void ZDFLadderFilter::process() {
+    process(&in, nullptr, &hpOut, &bpOut, 1);
+}
+
+
+/**
+ * @brief Process a block of samples
+ * @param in Input buffer
+ * @param lp Lowpass output buffer (overdriven like getLpOut()), may be nullptr
+ * @param hp Highpass output buffer, may be nullptr
+ * @param bp Bandpass output buffer, may be nullptr
+ * @param n Number of samples
+ */
+void ZDFLadderFilter::process(const float *in, float *lp, float *hp, float *bp, int n) {
+    process(in, nullptr, lp, hp, bp, n);
+}
+
+
+/**
+ * @brief Process a block of samples with audio rate cutoff modulation
+ * @param in Input buffer
+ * @param cutoff Cutoff for every sample in the range of 0..1 like setFrequency(), nullptr to use setFrequency()
+ * @param lp Lowpass output buffer (overdriven like getLpOut()), may be nullptr
+ * @param hp Highpass output buffer, may be nullptr
+ * @param bp Bandpass output buffer, may be nullptr
+ * @param n Number of samples
+ */
+void ZDFLadderFilter::process(const float *in, const float *cutoff, float *lp, float *hp, float *bp, int n) {
+    if (n <= 0) return;
+
+    switch (os.factor) {
+        case 2:
+            processBlock<2>(in, cutoff, lp, hp, bp, n);
+            break;
+        case 4:
+            processBlock<4>(in, cutoff, lp, hp, bp, n);
+            break;
+        case 16:
+            processBlock<16>(in, cutoff, lp, hp, bp, n);
+            break;
+        default:
+            processBlock<8>(in, cutoff, lp, hp, bp, n);
+    }
+}
+
+
+/**
+ * @brief Block processing with fixed oversampling factor
+ * @param in Input buffer
+ * @param cutoff Cutoff for every sample, may be nullptr
+ * @param lp Lowpass output buffer, may be nullptr
+ * @param hp Highpass output buffer, may be nullptr
+ * @param bp Bandpass output buffer, may be nullptr
+ * @param n Number of samples
+ */
+template<int FACTOR>
+void ZDFLadderFilter::processBlock(const float *in, const float *cutoff, float *lp, float *hp, float *bp, int n) {
+    float z1 = s1, z2 = s2, z3 = s3, z4 = s4;
+    float G = ZDFLadderFilter::G, h = ZDFLadderFilter::h, norm = ZDFLadderFilter::norm;
+    float G4 = G * G * G * G;
+
+    float fs = sr * FACTOR;
+    float fmax = fs * 0.45f, halfPeriod = 0.5f * isr / FACTOR;
+
+    /* output overdrive, see LadderFilter::getLpOut() */
+    float d = quadraticBipolar(drive) * 50 + 1;
+    float outGain = 1 / (drive * 3 + 1);
+
+    for (int j = 0; j < n; j++) {
+        if (cutoff) {
+            /* audio rate cutoff, g / (1 + g) with g = tan(w) is sin(w) / (sin(w) + cos(w)) from the sine table */
+            float t = fminf(cutoffToHz(cutoff[j]), fmax) * halfPeriod;
+            float sn = sineTable.lookup(t);
+
+            G = sn / (sn + sineTable.lookup(t + 0.25f));
+            h = 1.f - G;
+            G4 = G * G * G * G;
+            norm = 1.f / (1.f + k * G4);
+        }
+
+        os.template upsample<FACTOR>(in[j]);
+
+        for (int i = 0; i < FACTOR; i++) {
+            float x = os.up[i];
+            float v, y1, y2, y3, y4;
+
+            /* solve the zero-delay feedback loop of the linear ladder for the driven input */
+            float S = G * (G * (G * h * z1 + h * z2) + h * z3) + h * z4;
+            float xg = gain * x;
+            float y = (G4 * xg + S) * norm;
+
+            float u = fastTanh(xg - k * y);
+
+            /* four TPT one-pole stages with saturating inputs */
+            v = G * (u - z1);
+            y1 = v + z1;
+            z1 = y1 + v;
+
+            v = G * (fastTanh(y1) - z2);
+            y2 = v + z2;
+            z2 = y2 + v;
+
+            v = G * (fastTanh(y2) - z3);
+            y3 = v + z3;
+            z3 = y3 + v;
+
+            v = G * (fastTanh(y3) - z4);
+            y4 = v + z4;
+            z4 = y4 + v;
+
+            os.data[i][LP_CHANNEL] = y4;
+            os.data[i][HP_CHANNEL] = u - 4.f * y1 + 6.f * y2 - 4.f * y3 + y4;
+            os.data[i][BP_CHANNEL] = 4.f * (y2 - 2.f * y3 + y4);
+        }
+
+        os.template downsample<FACTOR>();
+
+        lpOut = os.getDownsampled(LP_CHANNEL);
+
+        if (lp) lp[j] = lpOut * (fabsf(lpOut) + d) / (lpOut * lpOut + (d - 1) * fabsf(lpOut) + 1) * outGain;
+        if (hp) hp[j] = os.getDownsampled(HP_CHANNEL) * ZDF_HP_LEVEL;
+        if (bp) bp[j] = os.getDownsampled(BP_CHANNEL) * ZDF_BP_LEVEL;
+    }
+
+    /* modulated coefficients only live for the block, the next one without cutoff is back at setFrequency() */
+    s1 = z1;
+    s2 = z2;
+    s3 = z3;
+    s4 = z4;
+}
+
+
+/**
+ * @brief Return cutoff frequency in the range of 0..1
+ * @return
+ */
+float ZDFLadderFilter::getFrequency() const {
+    return frequency;
+}
+
+
+/**
+ * @brief Update cutoff frequency in the range of 0..1
+ * @param frequency
+ */
+void ZDFLadderFilter::setFrequency(float frequency) {
+    if (ZDFLadderFilter::frequency != frequency) {
+        ZDFLadderFilter::frequency = frequency;
+        // translate frequency to logarithmic scale
+        freqHz = cutoffToHz(frequency);
+
+        invalidate();
+    }
+}
+
+
+/**
+ * @brief Get resonance
+ * @return
+ */
+float ZDFLadderFilter::getResonance() const {
+    return resonance;
+}
+
+
+/**
+ * @brief Set resonance
+ * @param resonance
+ */
+void ZDFLadderFilter::setResonance(float resonance) {
+    if (ZDFLadderFilter::resonance != resonance) {
+        ZDFLadderFilter::resonance = resonance;
+
+        invalidate();
+    }
+}
+
+
+/**
+ * @brief Get overdrive
+ * @return
+ */
+float ZDFLadderFilter::getDrive() const {
+    return drive;
+}
+
+
+/**
+ * @brief Set overdrive
+ * @param drive
+ */
+void ZDFLadderFilter::setDrive(float drive) {
+    if (ZDFLadderFilter::drive != drive) {
+        ZDFLadderFilter::drive = drive;
+
+        invalidate();
+    }
+}
+
+
+/**
+ * @brief Get frequency of cutoff in Hz
+ * @return
+ */
+float ZDFLadderFilter::getFreqHz() const {
+    return freqHz;
+}
+
+
+/**
+ * @brief Get oversampling factor
+ * @return
+ */
+int ZDFLadderFilter::getOversampling() const {
+    return os.factor;
+}
+
+
+/**
+ * @brief Set oversampling factor
+ * @param factor 2, 4, 8 or 16
+ */
+void ZDFLadderFilter::setOversampling(int factor) {
+    if (os.factor != factor) {
+        os.setFactor(factor);
+        invalidate();
+    }
+}
+
+
+/**
+ * @brief Set input channel with sample
+ * @param in
+ */
+void ZDFLadderFilter::setIn(float in) {
+    ZDFLadderFilter::in = in;
+}
+
+
+/**
+ * @brief Get lowpass output
+ * @return
+ */
+float ZDFLadderFilter::getLpOut() {
+    float d = quadraticBipolar(drive) * 50 + 1;
+    float out = lpOut * (fabsf(lpOut) + d) / (lpOut * lpOut + (d - 1) * fabsf(lpOut) + 1);
+
+    return out * 1 / (drive * 3 + 1);
+}
+
+
+/**
+ * @brief Bandpass output current
+ * @return
+ */
+float ZDFLadderFilter::getBpOut() const {
+    return bpOut;
+}
+
+
+/**
+ * @brief Highpass output current
+ * @return
+ */
+float ZDFLadderFilter::getHpOut() const {
+    return hpOut;
+}
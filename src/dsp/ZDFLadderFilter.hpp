@@ -0,0 +1,60 @@
+#pragma once
+
+
+#include "DSPEffect.hpp"
+#include "DSPHost.hpp"
+#include "DSPMath.hpp"
+#include "Oversampler.hpp"
+#include "LadderFilter.hpp"
+
+#define ZDF_OVERSAMPLE 2
+#define ZDF_HP_LEVEL 40.f // HP and BP taps matched to the levels of the classic core with a saw at low resonance
+#define ZDF_BP_LEVEL 24.f
+
+namespace rack {
+
+    /**
+     * @brief Zero-delay-feedback (TPT) ladder with tanh stage nonlinearities
+     *
+     * Alternative core to LadderFilter with the same interface. The feedback path is solved
+     * implicitly from the linear ladder, so the filter stays stable and in tune up to nyquist
+     * and needs only 2x oversampling for the remaining aliasing of the nonlinearities.
+     */
+    struct ZDFLadderFilter : DSPEffect {
+    private:
+        float G, h, k, gain, norm;
+        float s1, s2, s3, s4;
+        float freqHz, frequency, resonance, drive;
+        float in, lpOut, bpOut, hpOut;
+
+        Oversampler<3> os;
+
+        template<int FACTOR>
+        void processBlock(const float *in, const float *cutoff, float *lp, float *hp, float *bp, int n);
+
+    public:
+        ZDFLadderFilter();
+
+        void invalidate() override;
+
+        void process() override;
+        void process(const float *in, float *lp, float *hp, float *bp, int n);
+        void process(const float *in, const float *cutoff, float *lp, float *hp, float *bp, int n);
+
+        float getFrequency() const;
+        void setFrequency(float frequency);
+        float getResonance() const;
+        void setResonance(float resonance);
+        float getDrive() const;
+        void setDrive(float drive);
+        float getFreqHz() const;
+        int getOversampling() const;
+        void setOversampling(int factor);
+
+        void setIn(float in);
+        float getLpOut();
+
+        float getBpOut() const;
+        float getHpOut() const;
+    };
+}